@@ -1,131 +1,621 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <queue>
 #include <algorithm>
-#include <unordered_set>
 #include <unordered_map>
 #include <limits>
 #include <iomanip>
+#include <sstream>
 #include <chrono>
 #include <cmath>
 #include <set>
-#include <functional>
+#include <memory>
+#include <string>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <numeric>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../Common/intersect.h"
+#include "../Common/snapshot.h"
+#include "../Common/clique_cache.h"
+#include "../Common/perf_counters.h"
+#include "../Common/parallel.h"
+#include "../Common/edge_list.h"
+#include "../Common/metrics.h"
+#include "../Common/max_flow.h"
 
 using namespace std;
 
+// Read-only view of one sorted neighbour list inside the CSR arrays
+struct NeighborRange {
+    const int* first;
+    const int* last;
+    
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    int size() const { return static_cast<int>(last - first); }
+    
+    // Binary search for v in the sorted list
+    bool contains(int v) const { return binary_search(first, last, v); }
+};
+
+// Fixed-width clique storage: every clique of the store occupies exactly
+// `width` consecutive ints of one buffer, so a million triangles are three
+// million ints instead of a million separately allocated vectors. An
+// optional CSR index maps each vertex to the ids of the cliques containing it.
+class CliqueStore {
+private:
+    int width = 0;
+    IntArray members;               // Clique i is members[i*width .. (i+1)*width)
+    vector<size_t> incidenceOffsets; // Cliques of v are incidence[incidenceOffsets[v] ..]
+    vector<int> incidence;
+    
+public:
+    // Read-only view of a clique or of a vertex's clique ids
+    struct Span {
+        const int* first;
+        const int* last;
+        
+        const int* begin() const { return first; }
+        const int* end() const { return last; }
+        int size() const { return static_cast<int>(last - first); }
+        int operator[](int i) const { return first[i]; }
+    };
+    
+    // Forward iterator yielding one Span per clique, in storage order
+    class Iterator {
+    private:
+        const int* position;
+        int stride;
+        
+    public:
+        Iterator(const int* p, int w) : position(p), stride(w) {}
+        Span operator*() const { return {position, position + stride}; }
+        Iterator& operator++() { position += stride; return *this; }
+        bool operator!=(const Iterator& other) const { return position != other.position; }
+    };
+    
+    // Drop all cliques and switch to the given width
+    void reset(int w) {
+        width = w;
+        members = IntArray();
+        vector<size_t>().swap(incidenceOffsets);
+        vector<int>().swap(incidence);
+    }
+    
+    void add(const int* clique) {
+        members.append(clique, width);
+    }
+    
+    // Use cliques stored in a mapped file instead of listing them again
+    void borrow(shared_ptr<const MappedFile> file, const int* cells, size_t count, int w) {
+        reset(w);
+        members.borrow(move(file), cells, count);
+    }
+    
+    // Replace the contents by cliques already laid out back to back
+    void adopt(vector<int>&& cells) {
+        members.adopt(move(cells));
+    }
+    
+    // All cliques back to back, as written to disk
+    const IntArray& cells() const { return members; }
+    
+    int cliqueWidth() const { return width; }
+    size_t size() const { return width == 0 ? 0 : members.size() / width; }
+    bool empty() const { return members.size() == 0; }
+    
+    Span operator[](size_t i) const {
+        const int* p = members.data() + i * width;
+        return {p, p + width};
+    }
+    
+    Iterator begin() const { return Iterator(members.data(), width); }
+    Iterator end() const { return Iterator(members.data() + members.size(), width); }
+    
+    // Build the vertex -> clique index with one counting pass and one fill pass
+    void buildIncidence(int n) {
+        incidenceOffsets.assign(n + 1, 0);
+        for (int v : members) {
+            incidenceOffsets[v + 1]++;
+        }
+        for (int v = 0; v < n; v++) {
+            incidenceOffsets[v + 1] += incidenceOffsets[v];
+        }
+        
+        vector<size_t> cursor(incidenceOffsets.begin(), incidenceOffsets.end() - 1);
+        incidence.resize(members.size());
+        for (size_t i = 0; i < members.size(); i++) {
+            incidence[cursor[members[i]]++] = i / width;
+        }
+    }
+    
+    bool hasIncidence() const { return !incidenceOffsets.empty(); }
+    
+    // Ids of the cliques containing v (empty until buildIncidence)
+    Span cliquesOf(int v) const {
+        if (incidenceOffsets.empty()) return {nullptr, nullptr};
+        return {incidence.data() + incidenceOffsets[v], incidence.data() + incidenceOffsets[v + 1]};
+    }
+};
+
 // Class to represent a graph
 class Graph {
 private:
     int n; // Number of vertices
-    vector<unordered_set<int>> adj; // Adjacency list using sets for faster lookups
+    vector<pair<int, int>> pendingEdges; // Edges added since the last CSR build
+    IntArray offsets;   // CSR row offsets, neighbours of u are neighbors[offsets[u] .. offsets[u+1])
+    IntArray neighbors; // Concatenated neighbour lists, each sorted and duplicate-free
+    IntArray outOffsets;   // Same layout for the degeneracy-ordered DAG
+    IntArray outNeighbors; // Out-neighbours (later in degeneracy order), sorted by id
+    int degeneracy = 0;       // Largest out-degree in the DAG
     
     // Cache for cliques to avoid recalculation
-    mutable vector<vector<int>> hCliquesCache;
-    mutable vector<vector<int>> hMinus1CliquesCache;
-    mutable vector<vector<int>> vertexToCliqueMap;
+    mutable vector<long long> hCliqueDegrees; // Number of h-cliques containing each vertex
+    mutable long long hCliqueTotal = 0;       // Number of h-cliques
+    mutable CliqueStore hMinus1CliquesCache;  // (h-1)-cliques
     mutable bool cacheInitialized = false;
+    CliqueStore nextLevelCliques; // h-cliques of the current batch level
+    int cliqueLevel = 0;          // h held by the batch chain, 0 when unused
+    string cliqueCacheDir; // Directory of persisted clique indexes; empty disables them
+    
+    // Which graph and h a persisted clique index (Common/clique_cache.h) is for
+    CliqueCacheKey cliqueCacheKey(int h) const {
+        return {fingerprint(), n, (int64_t)neighbors.size(), h};
+    }
     
-    // Efficient check if vertex v is connected to all vertices in current
-    bool isConnectedToAll(int v, const vector<int>& current) const {
-        if (v < 0 || v >= n) return false;
+    string cliqueCachePath(int h) const {
+        return cliqueCacheFileName(cliqueCacheDir, cliqueCacheKey(h));
+    }
+    
+    // Map a persisted clique index for h. The (h-1)-cliques are used in
+    // place; only the per-vertex degrees are copied out.
+    bool loadCliqueCache(const string& path, int h) const {
+        shared_ptr<MappedFile> file;
+        CliqueCacheView cache;
+        if (!mapCliqueCacheFile(path, cliqueCacheKey(h), file, cache)) return false;
         
-        for (int u : current) {
-            if (u < 0 || u >= n || adj[v].find(u) == adj[v].end()) {
-                return false;
-            }
-        }
+        hCliqueDegrees.resize(n);
+        memcpy(hCliqueDegrees.data(), cache.degrees, sizeof(int64_t) * n);
+        hCliqueTotal = cache.hCliqueTotal;
+        hMinus1CliquesCache.borrow(file, cache.cliques, (size_t)cache.storedCliques * (h - 1), h - 1);
         return true;
     }
-
-    // Non-recursive implementation of clique finding for h=3 (triangles)
-    void findTriangles(vector<vector<int>>& cliques) const {
-        cliques.clear();
+    
+    // Persist the current clique index under a temporary name, then rename
+    bool saveCliqueCache(const string& path, int h) const {
+        mkdir(cliqueCacheDir.c_str(), 0755);
+        return writeCliqueCacheFile(path, cliqueCacheKey(h), hCliqueTotal, hCliqueDegrees.data(),
+                                    hMinus1CliquesCache.cells().data(), hMinus1CliquesCache.size());
+    }
+    
+    int threadCount = 1; // Threads used to list and count cliques
+    
+    // A small candidate set and the out-edges among its members as bit rows:
+    // bit j of row i is set when candidate j is an out-neighbour of candidate
+    // i. Bit order is candidate order, i.e. id order, so listing from it
+    // emits cliques in exactly the order of the sorted-list lister.
+    struct LocalGraph {
+        vector<int> slot;          // graph id -> candidate index, -1 if absent
+        vector<int> vertex;        // candidate index -> graph id
+        vector<uint64_t> rows;     // count rows of `words` words
+        vector<uint64_t> levels;   // candidate bitset of each depth
+        int words = 0;
+    };
+    
+    // Largest candidate set turned into a LocalGraph: four words per row,
+    // so an intersection is four ANDs and popcounts
+    static const int LOCAL_GRAPH_LIMIT = 256;
+    
+    // Per-thread state of the clique lister. levels[d] is the candidate
+    // buffer of depth d >= 2; depth 1 reads the root's out-list in place.
+    struct ListingScratch {
+        vector<int> clique;
+        vector<vector<int>> levels;
+        LocalGraph local;
         
-        cout << "Finding triangles using optimized method... " << flush;
-        int count = 0;
+        void prepare(int h, int reserve) {
+            clique.assign(h, 0);
+            levels.resize(h);
+            for (auto& level : levels) {
+                if (level.size() < (size_t)reserve + INTERSECT_PADDING) level.resize(reserve + INTERSECT_PADDING);
+            }
+        }
+    };
+    
+    // Roots per initial task of the parallel lister
+    static const int ROOT_CHUNK = 64;
+    
+    // For h >= 4, roots with at least this many out-neighbours are split
+    // into tasks of SPLIT_GRAIN depth-1 candidates each
+    static const int SPLIT_OUT_DEGREE = 16;
+    static const int SPLIT_GRAIN = 4;
+    
+    // Unit of parallel listing: roots [first, last), or, if to >= 0, only
+    // the depth-1 candidates [from, to) of root first
+    struct ListingTask {
+        int first = 0, last = 0;
+        int from = 0, to = -1;
         
-        // For each edge (u, v)
-        for (int u = 0; u < n; u++) {
-            // For each neighbor v of u
-            for (int v : adj[u]) {
-                if (v <= u) continue; // Process each edge once
+        // Position of the task's cliques in the serial listing order
+        long long order() const { return (long long)first << 32 | (to < 0 ? 0 : from); }
+    };
+    
+    // Run the clique lister on the work-stealing pool. emitFor(task, worker)
+    // returns the emitter for one task's cliques; tasks of one worker never
+    // overlap. Root ranges are dealt out in contiguous blocks, and a range
+    // that reaches a heavy root hands the root's subtrees and the rest of
+    // the range back to the pool, where idle threads can steal them.
+    // Returns the pool's task, steal and idle summary.
+    template <class EmitFor>
+    string listOnPool(int h, EmitFor emitFor) const {
+        int ranges = (n + ROOT_CHUNK - 1) / ROOT_CHUNK;
+        StealingPool<ListingTask> pool(max(1, min(threadCount, ranges)));
+        int workers = pool.workerCount();
+        for (int r = 0; r < ranges; r++) {
+            ListingTask task;
+            task.first = r * ROOT_CHUNK;
+            task.last = min(n, (r + 1) * ROOT_CHUNK);
+            pool.push((long long)r * workers / ranges, task);
+        }
+        
+        vector<ListingScratch> scratch(workers);
+        pool.run([&](const ListingTask& task, int worker) {
+            ListingScratch& local = scratch[worker];
+            if (local.clique.empty()) local.prepare(h, degeneracy);
+            auto emit = emitFor(task, worker);
+            if (task.to >= 0) {
+                listCliquesFromRoot(task.first, task.from, task.to, h, local, emit);
+                return;
+            }
+            
+            for (int u = task.first; u < task.last; u++) {
+                int outDegree = outOffsets[u + 1] - outOffsets[u];
+                if (h < 4 || outDegree < SPLIT_OUT_DEGREE) {
+                    listCliquesFromRoot(u, 0, outDegree, h, local, emit);
+                    continue;
+                }
                 
-                // For each neighbor w of u
-                for (int w : adj[u]) {
-                    if (w <= v) continue; // Ensure w > v > u to avoid duplicates
-                    
-                    // Check if w is also a neighbor of v
-                    if (adj[v].find(w) != adj[v].end()) {
-                        cliques.push_back({u, v, w});
-                        
-                        // Print progress
-                        count++;
-                        if (count % 10000 == 0) {
-                            cout << "." << flush;
-                        }
-                    }
+                // The rest of the range goes first so that this worker,
+                // popping from the back, starts on the subtrees of u
+                if (u + 1 < task.last) {
+                    ListingTask rest;
+                    rest.first = u + 1;
+                    rest.last = task.last;
+                    pool.push(worker, rest);
+                }
+                for (int from = 0; from < outDegree; from += SPLIT_GRAIN) {
+                    ListingTask part;
+                    part.first = u;
+                    part.last = u + 1;
+                    part.from = from;
+                    part.to = min(outDegree, from + SPLIT_GRAIN);
+                    pool.push(worker, part);
                 }
+                return;
             }
+        }, meterWorkers());
+        return pool.summary();
+    }
+    
+    // Emit every h-clique whose earliest vertex in degeneracy order lies in
+    // [first, last), roots in increasing id
+    template <class Emit>
+    void listCliquesFromRoots(int first, int last, int h, ListingScratch& scratch, Emit& emit) const {
+        for (int u = first; u < last; u++) {
+            listCliquesFromRoot(u, 0, outOffsets[u + 1] - outOffsets[u], h, scratch, emit);
+        }
+    }
+    
+    // Emit the h-cliques rooted at u whose second vertex is one of the
+    // out-neighbours with index from .. to - 1
+    template <class Emit>
+    void listCliquesFromRoot(int u, int from, int to, int h, ListingScratch& scratch, Emit& emit) const {
+        scratch.clique[0] = u;
+        if (h == 1) {
+            emit(scratch.clique.data());
+            return;
         }
         
-        cout << " Found " << cliques.size() << " triangles." << endl;
+        NeighborRange out = outNeighborsOf(u);
+        if (out.size() < h - 1) return;
+        
+        if (h >= 3 && out.size() <= LOCAL_GRAPH_LIMIT) {
+            buildLocalGraph(out.begin(), out.size(), h, scratch.local);
+            extendLocalClique(1, h, scratch.clique, scratch.local, emit, from, to);
+        } else {
+            extendClique(1, h, scratch.clique, scratch.levels, out.begin(), out.size(), emit, from, to);
+        }
     }
     
-    // Efficient clique finder with iterative approach for small h
-    void findCliquesIterative(int h, vector<vector<int>>& cliques) const {
-        cliques.clear();
+    // Load candidates[0..count) into local and make them the depth-1 level
+    void buildLocalGraph(const int* candidates, int count, int h, LocalGraph& local) const {
+        if (local.slot.size() < (size_t)n) local.slot.assign(n, -1);
+        int words = (count + 63) / 64;
+        local.words = words;
+        local.vertex.assign(candidates, candidates + count);
+        local.rows.assign((size_t)count * words, 0);
+        local.levels.assign((size_t)h * words, 0);
         
-        // Special case for triangles (h=3)
-        if (h == 3) {
-            findTriangles(cliques);
+        for (int i = 0; i < count; i++) {
+            local.slot[candidates[i]] = i;
+        }
+        for (int i = 0; i < count; i++) {
+            uint64_t* row = &local.rows[(size_t)i * words];
+            for (int w : outNeighborsOf(candidates[i])) {
+                int j = local.slot[w];
+                if (j >= 0) row[j >> 6] |= uint64_t(1) << (j & 63);
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            local.slot[candidates[i]] = -1;
+        }
+        
+        uint64_t* first = &local.levels[words];
+        for (int i = 0; i < count; i++) {
+            first[i >> 6] |= uint64_t(1) << (i & 63);
+        }
+    }
+    
+    // Bits from .. to - 1 of word k of a bitset
+    static uint64_t wordRange(int k, int from, int to) {
+        int low = max(from - 64 * k, 0), high = min(to - 64 * k, 64);
+        if (low >= high) return 0;
+        uint64_t upTo = high == 64 ? ~uint64_t(0) : (uint64_t(1) << high) - 1;
+        return upTo & ~((uint64_t(1) << low) - 1);
+    }
+    
+    // extendClique over a LocalGraph: the candidates of each depth are a
+    // bitset in local.levels and narrowing them is an AND with one row.
+    // Only candidates with index from .. to - 1 are tried at this depth.
+    template <class Emit>
+    void extendLocalClique(int depth, int h, vector<int>& clique, LocalGraph& local, Emit& emit,
+                           int from = 0, int to = numeric_limits<int>::max()) const {
+        int words = local.words;
+        const uint64_t* candidates = &local.levels[(size_t)depth * words];
+        
+        if (depth == h - 1) {
+            for (int k = 0; k < words; k++) {
+                for (uint64_t bits = candidates[k] & wordRange(k, from, to); bits; bits &= bits - 1) {
+                    clique[depth] = local.vertex[k * 64 + __builtin_ctzll(bits)];
+                    emit(clique.data());
+                }
+            }
             return;
         }
         
-        cout << "Finding " << h << "-cliques using backtracking (limited search)... " << flush;
+        uint64_t* next = &local.levels[(size_t)(depth + 1) * words];
+        int needed = h - depth - 1;
+        for (int k = 0; k < words; k++) {
+            for (uint64_t bits = candidates[k] & wordRange(k, from, to); bits; bits &= bits - 1) {
+                int i = k * 64 + __builtin_ctzll(bits);
+                const uint64_t* row = &local.rows[(size_t)i * words];
+                int found = 0;
+                for (int x = 0; x < words; x++) {
+                    next[x] = candidates[x] & row[x];
+                    found += popCount64(next[x]);
+                }
+                if (found < needed) continue;
+                
+                clique[depth] = local.vertex[i];
+                extendLocalClique(depth + 1, h, clique, local, emit);
+            }
+        }
+    }
+    
+    // Number of cliques extendLocalClique would emit; the last level is
+    // only popcounted
+    long long countLocalExtensions(int depth, int h, LocalGraph& local) const {
+        int words = local.words;
+        const uint64_t* candidates = &local.levels[(size_t)depth * words];
+        long long total = 0;
         
-        // Set a limit for the search
-        const size_t MAX_CLIQUES = 1000000; // Adjust based on your memory constraints
-        size_t maxIterations = 100000000;   // Prevent excessive recursion
-        size_t iterations = 0;
+        if (depth == h - 1) {
+            for (int x = 0; x < words; x++) {
+                total += popCount64(candidates[x]);
+            }
+            return total;
+        }
         
-        // Use backtracking with limits
-        function<void(vector<int>&, int)> backtrack = [&](vector<int>& current, int start) {
-            iterations++;
-            
-            // Show progress
-            if (iterations % 100000 == 0) {
-                cout << "." << flush;
-                if (iterations % 5000000 == 0) {
-                    cout << " [" << iterations << " iterations, " << cliques.size() << " cliques]" << endl;
+        uint64_t* next = &local.levels[(size_t)(depth + 1) * words];
+        int needed = h - depth - 1;
+        for (int k = 0; k < words; k++) {
+            for (uint64_t bits = candidates[k]; bits; bits &= bits - 1) {
+                const uint64_t* row = &local.rows[(size_t)(k * 64 + __builtin_ctzll(bits)) * words];
+                int found = 0;
+                for (int x = 0; x < words; x++) {
+                    next[x] = candidates[x] & row[x];
+                    found += popCount64(next[x]);
+                }
+                if (depth == h - 2) {
+                    total += found;
+                } else if (found >= needed) {
+                    total += countLocalExtensions(depth + 1, h, local);
                 }
             }
-            
-            // Limit reached
-            if (cliques.size() >= MAX_CLIQUES || iterations >= maxIterations) {
-                return;
+        }
+        return total;
+    }
+    
+    // Recursive step of the k-clique lister. candidates[0..count) are the
+    // sorted vertices that can take position depth of the clique: every one
+    // of them is an out-neighbour of all vertices already in clique[0..depth).
+    // The next level is written into levels[depth + 1]. Only candidates
+    // from .. to - 1 are tried at this depth.
+    template <class Emit>
+    void extendClique(int depth, int h, vector<int>& clique, vector<vector<int>>& levels,
+                      const int* candidates, int count, Emit& emit,
+                      int from = 0, int to = numeric_limits<int>::max()) const {
+        int stop = min(count, to);
+        if (depth == h - 1) {
+            for (int i = from; i < stop; i++) {
+                clique[depth] = candidates[i];
+                emit(clique.data());
             }
+            return;
+        }
+        
+        int* next = levels[depth + 1].data();
+        int needed = h - depth - 1;
+        for (int i = from; i < stop; i++) {
+            int v = candidates[i];
+            NeighborRange out = outNeighborsOf(v);
+            if (out.size() < needed) continue;
+            int found = intersectInto(candidates, count, out.begin(), out.size(), next);
+            if (found < needed) continue;
             
-            if (current.size() == h) {
-                cliques.push_back(current);
-                return;
+            clique[depth] = v;
+            extendClique(depth + 1, h, clique, levels, next, found, emit);
+        }
+    }
+    
+    // Number of cliques extendClique would emit from the same state. The
+    // last level is only counted, so nothing is materialized for it.
+    long long countExtensions(int depth, int h, vector<vector<int>>& levels, const int* candidates, int count) const {
+        if (depth == h - 1) return count;
+        
+        int needed = h - depth - 1;
+        long long total = 0;
+        for (int i = 0; i < count; i++) {
+            NeighborRange out = outNeighborsOf(candidates[i]);
+            if (out.size() < needed) continue;
+            if (depth == h - 2) {
+                total += intersectCount(candidates, count, out.begin(), out.size());
+                continue;
             }
+            int* next = levels[depth + 1].data();
+            int found = intersectInto(candidates, count, out.begin(), out.size(), next);
+            if (found >= needed) total += countExtensions(depth + 1, h, levels, next, found);
+        }
+        return total;
+    }
+    
+    // Collect all h-cliques into a clique store
+    void findCliques(int h, CliqueStore& cliques) const {
+        cliques.reset(h);
+        
+        progressOutput() << "Listing " << h << "-cliques in degeneracy order... " << flush;
+        
+        if (threadCount <= 1 || h <= 0) {
+            forEachClique(h, [&](const int* clique) {
+                cliques.add(clique);
+                
+                // Print progress
+                if (!quietMode && cliques.size() % 100000 == 0) {
+                    cout << "." << flush;
+                }
+            });
+        } else {
+            // Each task fills its own buffer; concatenating the buffers in
+            // task order reproduces the serial clique order exactly
+            vector<vector<pair<long long, vector<int>>>> workerCells(threadCount);
+            string schedule = listOnPool(h, [&](const ListingTask& task, int worker) {
+                workerCells[worker].emplace_back(task.order(), vector<int>());
+                vector<int>* out = &workerCells[worker].back().second;
+                return [out, h](const int* clique) {
+                    out->insert(out->end(), clique, clique + h);
+                };
+            });
+            progressOutput() << " [" << schedule << "] " << flush;
             
-            for (int i = start; i < n && cliques.size() < MAX_CLIQUES; i++) {
-                if (isConnectedToAll(i, current)) {
-                    current.push_back(i);
-                    backtrack(current, i + 1);
-                    current.pop_back();
+            vector<pair<long long, vector<int>>> rangeCells;
+            for (auto& cells : workerCells) {
+                for (auto& task : cells) {
+                    rangeCells.push_back(move(task));
                 }
             }
-        };
+            sort(rangeCells.begin(), rangeCells.end(), [](const pair<long long, vector<int>>& a, const pair<long long, vector<int>>& b) {
+                return a.first < b.first;
+            });
+            
+            size_t cells = 0;
+            for (const auto& part : rangeCells) {
+                cells += part.second.size();
+            }
+            vector<int> all;
+            all.reserve(cells);
+            for (auto& part : rangeCells) {
+                all.insert(all.end(), part.second.begin(), part.second.end());
+                vector<int>().swap(part.second);
+            }
+            cliques.adopt(move(all));
+        }
         
-        vector<int> current;
-        backtrack(current, 0);
+        progressOutput() << " Found " << cliques.size() << " cliques." << endl;
+    }
+    
+    // Order vertices by repeatedly removing one of minimum remaining degree
+    // (bucket queue, O(n + m)) and orient every edge from the earlier vertex
+    // to the later one. Every out-degree is then at most the degeneracy.
+    void buildDegeneracyOrder() {
+        int maxDegree = 0;
+        for (int u = 0; u < n; u++) {
+            maxDegree = max(maxDegree, degree(u));
+        }
         
-        cout << " Found " << cliques.size() << " cliques" 
-             << (cliques.size() >= MAX_CLIQUES ? " (limit reached)" : "") 
-             << "." << endl;
+        vector<int> remaining(n), bucketStart(maxDegree + 2, 0), position(n), order(n);
+        for (int u = 0; u < n; u++) {
+            remaining[u] = degree(u);
+            bucketStart[remaining[u] + 1]++;
+        }
+        for (int d = 0; d <= maxDegree; d++) {
+            bucketStart[d + 1] += bucketStart[d];
+        }
+        {
+            vector<int> cursor(bucketStart.begin(), bucketStart.end() - 1);
+            for (int u = 0; u < n; u++) {
+                position[u] = cursor[remaining[u]]++;
+                order[position[u]] = u;
+            }
+        }
+        
+        degeneracy = 0;
+        for (int i = 0; i < n; i++) {
+            int u = order[i];
+            degeneracy = max(degeneracy, remaining[u]);
+            for (int v : neighborsOf(u)) {
+                if (position[v] <= i || remaining[v] <= remaining[u]) continue;
+                
+                // Swap v with the first vertex of its bucket, then shrink the bucket
+                int d = remaining[v];
+                int first = max(bucketStart[d], i + 1);
+                int w = order[first];
+                swap(order[first], order[position[v]]);
+                swap(position[w], position[v]);
+                bucketStart[d] = first + 1;
+                remaining[v]--;
+            }
+        }
+        
+        vector<int> dagOffsets(n + 1, 0);
+        for (int u = 0; u < n; u++) {
+            int outDegree = 0;
+            for (int v : neighborsOf(u)) {
+                if (position[v] > position[u]) outDegree++;
+            }
+            dagOffsets[u + 1] = dagOffsets[u] + outDegree;
+        }
+        vector<int> dagNeighbors(dagOffsets[n]);
+        for (int u = 0; u < n; u++) {
+            int k = dagOffsets[u];
+            for (int v : neighborsOf(u)) {
+                if (position[v] > position[u]) dagNeighbors[k++] = v;
+            }
+        }
+        outOffsets.adopt(move(dagOffsets));
+        outNeighbors.adopt(move(dagNeighbors));
     }
     
 public:
@@ -134,15 +624,105 @@ public:
             n = 0;
             cerr << "Warning: Invalid graph size. Creating empty graph." << endl;
         }
-        adj.resize(n);
+        offsets.adopt(vector<int>(n + 1, 0));
     }
     
     void addEdge(int u, int v) {
-        if (u < 0 || u >= n || v < 0 || v >= n) {
-            return; // Silently ignore invalid edges
+        if (u < 0 || u >= n || v < 0 || v >= n || u == v) {
+            return; // Silently ignore invalid edges and self-loops
+        }
+        pendingEdges.push_back({u, v});
+    }
+    
+    // Take a whole edge list at once (endpoints in 0..n-1, no self-loops)
+    // and build the CSR arrays from it
+    void setEdges(vector<pair<int, int>>&& edges) {
+        pendingEdges = move(edges);
+        finalize();
+    }
+    
+    // Build the CSR arrays from the edges added so far. Must be called once
+    // loading is done and before any query; duplicate edges are merged.
+    void finalize() {
+        for (int u = 0; u < n; u++) {
+            for (int i = offsets[u]; i < offsets[u + 1]; i++) {
+                if (u < neighbors[i]) pendingEdges.push_back({u, neighbors[i]});
+            }
+        }
+        
+        vector<int> rowLength(n, 0);
+        for (const auto& e : pendingEdges) {
+            rowLength[e.first]++;
+            rowLength[e.second]++;
+        }
+        
+        vector<int> rowOffsets(n + 1, 0);
+        for (int u = 0; u < n; u++) {
+            rowOffsets[u + 1] = rowOffsets[u] + rowLength[u];
+        }
+        
+        vector<int> cursor(rowOffsets.begin(), rowOffsets.end() - 1);
+        vector<int> rowNeighbors(rowOffsets[n], 0);
+        for (const auto& e : pendingEdges) {
+            rowNeighbors[cursor[e.first]++] = e.second;
+            rowNeighbors[cursor[e.second]++] = e.first;
+        }
+        vector<pair<int, int>>().swap(pendingEdges);
+        
+        // Sort each row and squeeze out duplicates in place
+        int write = 0;
+        for (int u = 0; u < n; u++) {
+            int rowStart = rowOffsets[u], rowEnd = rowOffsets[u + 1];
+            sort(rowNeighbors.begin() + rowStart, rowNeighbors.begin() + rowEnd);
+            rowOffsets[u] = write;
+            for (int i = rowStart; i < rowEnd; i++) {
+                if (i == rowStart || rowNeighbors[i] != rowNeighbors[i - 1]) {
+                    rowNeighbors[write++] = rowNeighbors[i];
+                }
+            }
         }
-        adj[u].insert(v);
-        adj[v].insert(u);
+        rowOffsets[n] = write;
+        rowNeighbors.resize(write);
+        rowNeighbors.shrink_to_fit();
+        offsets.adopt(move(rowOffsets));
+        neighbors.adopt(move(rowNeighbors));
+        
+        buildDegeneracyOrder();
+    }
+    
+    // Use CSR arrays that live in a mapped snapshot instead of building
+    // them; the graph keeps the mapping open for as long as it needs it
+    void attach(shared_ptr<const MappedFile> file, const int* rowOffsets, const int* rowNeighbors,
+                const int* dagOffsets, const int* dagNeighbors, int dagDegeneracy) {
+        offsets.borrow(file, rowOffsets, n + 1);
+        neighbors.borrow(file, rowNeighbors, rowOffsets[n]);
+        outOffsets.borrow(file, dagOffsets, n + 1);
+        outNeighbors.borrow(file, dagNeighbors, dagOffsets[n]);
+        degeneracy = dagDegeneracy;
+        vector<pair<int, int>>().swap(pendingEdges);
+        cacheInitialized = false;
+    }
+    
+    // CSR arrays and DAG metadata, as stored in a snapshot
+    const IntArray& adjacencyOffsets() const { return offsets; }
+    const IntArray& adjacency() const { return neighbors; }
+    const IntArray& dagOffsets() const { return outOffsets; }
+    const IntArray& dagAdjacency() const { return outNeighbors; }
+    int getDegeneracy() const { return degeneracy; }
+    
+    // Threads for clique listing and counting (1 = serial)
+    void setThreadCount(int threads) {
+        threadCount = max(1, threads);
+    }
+    
+    // Persist clique indexes in dir and reuse them on later runs ("" = off)
+    void setCliqueCacheDirectory(const string& dir) {
+        cliqueCacheDir = dir;
+    }
+    
+    // Hash of the vertex count and CSR arrays, identical for identical graphs
+    uint64_t fingerprint() const {
+        return graphFingerprint(n, offsets, neighbors);
     }
     
     // Get the number of vertices
@@ -150,560 +730,1379 @@ public:
         return n;
     }
     
-    // Check if edge exists
-    bool hasEdge(int u, int v) const {
-        if (u < 0 || u >= n || v < 0 || v >= n) return false;
-        return adj[u].find(v) != adj[u].end();
+    // Get the number of undirected edges
+    long long getEdgeCount() const {
+        return static_cast<long long>(neighbors.size()) / 2;
+    }
+    
+    // Sorted neighbours of u
+    NeighborRange neighborsOf(int u) const {
+        return {neighbors.data() + offsets[u], neighbors.data() + offsets[u + 1]};
+    }
+    
+    int degree(int u) const {
+        return offsets[u + 1] - offsets[u];
+    }
+    
+    // Sorted common neighbourhood of the given vertices: start from the member
+    // with the shortest list and merge-intersect the others into it
+    void commonNeighbors(const int* vertices, int count, vector<int>& result, vector<int>& scratch) const {
+        result.clear();
+        if (count == 0) return;
+        
+        int smallest = 0;
+        for (int i = 1; i < count; i++) {
+            if (degree(vertices[i]) < degree(vertices[smallest])) smallest = i;
+        }
+        NeighborRange base = neighborsOf(vertices[smallest]);
+        result.assign(base.begin(), base.end());
+        int size = result.size();
+        
+        for (int i = 0; i < count && size > 0; i++) {
+            if (i == smallest) continue;
+            NeighborRange other = neighborsOf(vertices[i]);
+            scratch.resize(size + INTERSECT_PADDING);
+            size = intersectInto(result.data(), size, other.begin(), other.size(), scratch.data());
+            result.swap(scratch);
+        }
+        result.resize(size);
+    }
+    
+    // Neighbours of u that come after it in degeneracy order
+    NeighborRange outNeighborsOf(int u) const {
+        return {outNeighbors.data() + outOffsets[u], outNeighbors.data() + outOffsets[u + 1]};
+    }
+    
+    // Call emit(const int* clique) exactly once for every h-clique, kClist style:
+    // each clique is found from its earliest vertex in degeneracy order by
+    // intersecting out-neighbourhoods, so no candidate is ever revisited.
+    // This is the serial lister; findCliques and countCliquesPerVertex
+    // spread the same work over threads when more than one is configured.
+    template <class Emit>
+    void forEachClique(int h, Emit&& emit) const {
+        if (h <= 0) return;
+        
+        ListingScratch scratch;
+        scratch.prepare(h, degeneracy);
+        listCliquesFromRoots(0, n, h, scratch, emit);
+    }
+    
+    // forEachClique spread over the configured threads: emitFor(worker)
+    // returns the emitter of one worker, which only that worker calls.
+    // Cliques arrive in no particular order.
+    template <class EmitFor>
+    void forEachCliqueOnWorkers(int h, EmitFor emitFor) const {
+        if (threadCount <= 1 || h <= 0) {
+            forEachClique(h, emitFor(0));
+            return;
+        }
+        listOnPool(h, [&](const ListingTask&, int worker) { return emitFor(worker); });
+    }
+    
+    int getThreadCount() const {
+        return threadCount;
+    }
+    
+    // Check if edge exists, searching the shorter of the two lists
+    bool hasEdge(int u, int v) const {
+        if (u < 0 || u >= n || v < 0 || v >= n) return false;
+        if (degree(u) > degree(v)) swap(u, v);
+        return neighborsOf(u).contains(v);
+    }
+    
+    // Count h-cliques without storing them: degrees[v] receives the number
+    // of h-cliques containing v and the total is returned. Memory is O(n)
+    // no matter how many cliques the graph has.
+    long long countCliquesPerVertex(int h, vector<long long>& degrees) const {
+        degrees.assign(n, 0);
+        long long total = 0;
+        
+        if (threadCount <= 1 || h <= 0) {
+            forEachClique(h, [&](const int* clique) {
+                for (int i = 0; i < h; i++) {
+                    degrees[clique[i]]++;
+                }
+                total++;
+            });
+            return total;
+        }
+        
+        // Every thread counts into private counters; no locks while listing
+        vector<vector<long long>> localDegrees(threadCount);
+        vector<long long> localTotal(threadCount, 0);
+        string schedule = listOnPool(h, [&](const ListingTask&, int worker) {
+            vector<long long>* counts = &localDegrees[worker];
+            long long* found = &localTotal[worker];
+            if (counts->empty()) counts->assign(n, 0);
+            return [counts, found, h](const int* clique) {
+                for (int i = 0; i < h; i++) {
+                    (*counts)[clique[i]]++;
+                }
+                (*found)++;
+            };
+        });
+        progressOutput() << " [" << schedule << "] " << flush;
+        
+        // Merge the private counters, each thread summing one vertex slice
+        auto meter = meterWorkers();
+        runTasks(threadCount, [&](int slice) {
+            auto counters = meter(slice);
+            int first = (long long)n * slice / threadCount;
+            int last = (long long)n * (slice + 1) / threadCount;
+            for (const auto& counts : localDegrees) {
+                if (counts.empty()) continue;
+                for (int v = first; v < last; v++) {
+                    degrees[v] += counts[v];
+                }
+            }
+        });
+        for (long long found : localTotal) {
+            total += found;
+        }
+        return total;
+    }
+    
+    // Buffers for countCliquesInside and forEachCliqueAround, owned by the
+    // caller so that repeated calls reuse the same memory
+    struct SubsetScratch {
+        vector<char> inside;
+        vector<int> clique;
+        vector<vector<int>> levels;
+        LocalGraph local;
+    };
+    
+    // Call emit(others) once for every h-clique made of u and h - 1 vertices
+    // v with alive[v] set; others points at those h - 1 vertices. The
+    // candidates are u's live neighbours, and the (h-1)-cliques among them
+    // are listed along the degeneracy orientation as in forEachClique.
+    template <class Emit>
+    void forEachCliqueAround(int u, int h, const vector<char>& alive, SubsetScratch& scratch, Emit&& emit) const {
+        if (h <= 0) return;
+        scratch.clique.resize(max(h - 1, 1));
+        if (h == 1) {
+            emit(scratch.clique.data());
+            return;
+        }
+        
+        // levels[0] holds the live neighbours; deeper levels are bounded by
+        // the degeneracy like in the lister
+        if (scratch.levels.size() < (size_t)h) scratch.levels.resize(h);
+        for (auto& level : scratch.levels) {
+            if (level.size() < (size_t)degeneracy + INTERSECT_PADDING) level.resize(degeneracy + INTERSECT_PADDING);
+        }
+        vector<int>& live = scratch.levels[0];
+        if (live.size() < (size_t)degree(u) + INTERSECT_PADDING) live.resize(degree(u) + INTERSECT_PADDING);
+        int count = 0;
+        for (int v : neighborsOf(u)) {
+            if (alive[v]) live[count++] = v;
+        }
+        if (count < h - 1) return;
+        
+        extendClique(0, h - 1, scratch.clique, scratch.levels, live.data(), count, emit);
+    }
+    
+    // Count the h-cliques whose vertices all lie in the given set by walking
+    // the degeneracy orientation restricted to it; no subgraph is built
+    long long countCliquesInside(const vector<int>& vertices, int h, SubsetScratch& scratch) const {
+        if (h <= 0) return 0;
+        if (h == 1) return vertices.size();
+        
+        scratch.inside.resize(n, 0);
+        if (scratch.levels.size() < (size_t)h) scratch.levels.resize(h);
+        for (auto& level : scratch.levels) {
+            if (level.size() < (size_t)degeneracy + INTERSECT_PADDING) level.resize(degeneracy + INTERSECT_PADDING);
+        }
+        for (int v : vertices) scratch.inside[v] = 1;
+        
+        long long total = 0;
+        int* first = scratch.levels[1].data();
+        for (int u : vertices) {
+            int size = 0;
+            for (int v : outNeighborsOf(u)) {
+                if (scratch.inside[v]) first[size++] = v;
+            }
+            if (size < h - 1) continue;
+            
+            if (h >= 3 && size <= LOCAL_GRAPH_LIMIT) {
+                buildLocalGraph(first, size, h, scratch.local);
+                total += countLocalExtensions(1, h, scratch.local);
+            } else {
+                total += countExtensions(1, h, scratch.levels, first, size);
+            }
+        }
+        
+        // Leave the mask all-zero for the next call
+        for (int v : vertices) scratch.inside[v] = 0;
+        return total;
+    }
+    
+    // Initialize per-vertex h-clique degrees and the (h-1)-clique store.
+    // The h-cliques themselves are only counted, never materialized.
+    void initializeCliqueCache(int h) const {
+        if (cacheInitialized) return;
+        
+        PhaseClock clock(metrics.cliques, perfPhases.cliques);
+        auto start = chrono::high_resolution_clock::now();
+        string cachePath = cliqueCacheDir.empty() ? string() : cliqueCachePath(h);
+        if (!cachePath.empty() && loadCliqueCache(cachePath, h)) {
+            auto end = chrono::high_resolution_clock::now();
+            progressOutput() << "Loaded clique cache " << cachePath << ": " << hCliqueTotal << " h-cliques, "
+                 << hMinus1CliquesCache.size() << " (h-1)-cliques in "
+                 << chrono::duration_cast<chrono::milliseconds>(end - start).count() << "ms" << endl;
+            cacheInitialized = true;
+            return;
+        }
+        
+        progressOutput() << "Precomputing cliques for h=" << h << "..." << flush;
+        
+        hMinus1CliquesCache.reset(h - 1);
+        
+        // Find cliques using iterative approach to avoid stack overflow
+        try {
+            hCliqueTotal = countCliquesPerVertex(h, hCliqueDegrees);
+            
+            if (h > 1) {
+                findCliques(h-1, hMinus1CliquesCache);
+            }
+            
+            auto end = chrono::high_resolution_clock::now();
+            auto duration = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+            
+            metrics.cliquesListed += hCliqueTotal + hMinus1CliquesCache.size();
+            progressOutput() << " Done! Counted " << hCliqueTotal << " h-cliques and stored " 
+                 << hMinus1CliquesCache.size() << " (h-1)-cliques in " << duration << "ms" << endl;
+            
+            cacheInitialized = true;
+            
+            if (!cachePath.empty() && !saveCliqueCache(cachePath, h)) {
+                cerr << "Warning: could not write clique cache " << cachePath << endl;
+            }
+        }
+        catch (const exception& e) {
+            cout << "Error in clique computation: " << e.what() << endl;
+            // Return with empty caches
+            hCliqueDegrees.assign(n, 0);
+            hCliqueTotal = 0;
+            hMinus1CliquesCache.reset(h - 1);
+        }
+    }
+    
+    // Batch mode over increasing h keeps the clique cache on a chain of
+    // levels: besides the (h-1)-cliques and h-clique degrees of the current
+    // h it stores the h-cliques, which become the next level's (h-1)-cliques.
+    // The chain starts at h = 1, where every vertex is a 1-clique.
+    void startCliqueLevels() {
+        hMinus1CliquesCache.reset(0);
+        hCliqueDegrees.assign(n, 1);
+        hCliqueTotal = n;
+        vector<int> vertices(n);
+        iota(vertices.begin(), vertices.end(), 0);
+        nextLevelCliques.reset(1);
+        nextLevelCliques.adopt(move(vertices));
+        cliqueLevel = 1;
+        cacheInitialized = true;
+    }
+    
+    int getCliqueLevel() const {
+        return cliqueLevel;
+    }
+    
+    // Move the chain from h to h + 1 by extending every h-clique with the
+    // common out-neighbours of all its members. An out-neighbour follows its
+    // vertex in degeneracy order, so an extension follows every member and
+    // each (h+1)-clique is found once, from its h earliest vertices. This
+    // does not depend on how members are stored (root first, then by id).
+    // keepNext = false only counts the (h+1)-cliques, for a last level that
+    // no later one extends.
+    void advanceCliqueLevel(bool keepNext) {
+        PhaseClock clock(metrics.cliques, perfPhases.cliques);
+        int h = cliqueLevel + 1;
+        swap(hMinus1CliquesCache, nextLevelCliques);
+        nextLevelCliques.reset(h);
+        const CliqueStore& previous = hMinus1CliquesCache;
+        size_t count = previous.size();
+        
+        // Slices of the stored cliques; concatenating the slices' output in
+        // order keeps the new level in a deterministic order
+        int slices = max<size_t>(1, min<size_t>(threadCount, count / 1024));
+        vector<vector<long long>> localDegrees(slices);
+        vector<long long> localTotal(slices, 0);
+        vector<vector<int>> localCells(slices);
+        auto meter = meterWorkers();
+        runTasks(slices, [&](int slice) {
+            auto counters = meter(slice);
+            size_t first = count * slice / slices;
+            size_t last = count * (slice + 1) / slices;
+            vector<long long>& counts = localDegrees[slice];
+            vector<int>& cells = localCells[slice];
+            vector<int> common, scratch;
+            counts.assign(n, 0);
+            for (size_t i = first; i < last; i++) {
+                CliqueStore::Span clique = previous[i];
+                NeighborRange base = outNeighborsOf(clique[h - 2]);
+                common.assign(base.begin(), base.end());
+                int size = common.size();
+                for (int j = 0; j < h - 2 && size > 0; j++) {
+                    NeighborRange other = outNeighborsOf(clique[j]);
+                    scratch.resize(size + INTERSECT_PADDING);
+                    size = intersectInto(common.data(), size, other.begin(), other.size(), scratch.data());
+                    common.swap(scratch);
+                }
+                if (size == 0) continue;
+                
+                for (int v : clique) {
+                    counts[v] += size;
+                }
+                for (int k = 0; k < size; k++) {
+                    counts[common[k]]++;
+                    if (keepNext) {
+                        cells.insert(cells.end(), clique.begin(), clique.end());
+                        cells.push_back(common[k]);
+                    }
+                }
+                localTotal[slice] += size;
+            }
+        });
+        
+        hCliqueDegrees.assign(n, 0);
+        hCliqueTotal = 0;
+        size_t total = 0;
+        for (int slice = 0; slice < slices; slice++) {
+            for (int v = 0; v < n; v++) {
+                hCliqueDegrees[v] += localDegrees[slice][v];
+            }
+            hCliqueTotal += localTotal[slice];
+            total += localCells[slice].size();
+        }
+        metrics.cliquesListed += hCliqueTotal;
+        if (keepNext) {
+            vector<int> all;
+            all.reserve(total);
+            for (auto& cells : localCells) {
+                all.insert(all.end(), cells.begin(), cells.end());
+                vector<int>().swap(cells);
+            }
+            nextLevelCliques.adopt(move(all));
+        }
+        cliqueLevel = h;
+        cacheInitialized = true;
+    }
+    
+    // Get all (h-1)-cliques
+    const CliqueStore& getHMinus1Cliques(int h) const {
+        initializeCliqueCache(h);
+        return hMinus1CliquesCache;
+    }
+    
+    // Calculate clique degree of a vertex
+    long long cliqueDegree(int v, int h) const {
+        if (v < 0 || v >= n) return 0;
+        initializeCliqueCache(h);
+        return hCliqueDegrees[v];
+    }
+    
+    // Find maximum clique degree
+    long long findMaxCliqueDegree(int h) const {
+        initializeCliqueCache(h);
+        
+        long long maxDegree = 0;
+        for (int v = 0; v < n; v++) {
+            maxDegree = max(maxDegree, hCliqueDegrees[v]);
+        }
+        return maxDegree;
+    }
+    
+    // Count h-cliques in the graph
+    long long countCliques(int h) const {
+        initializeCliqueCache(h);
+        return hCliqueTotal;
+    }
+    
+    // Calculate h-clique density
+    double cliqueDensity(int h) const {
+        long long cliqueCount = countCliques(h);
+        if (n == 0) return 0.0;
+        return static_cast<double>(cliqueCount) / n;
+    }
+    
+    // Get induced subgraph
+    Graph getInducedSubgraph(const vector<int>& vertices) const {
+        Graph subgraph(vertices.size());
+        unordered_map<int, int> indexMap;
+        
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (vertices[i] >= 0 && vertices[i] < n) {
+                indexMap[vertices[i]] = i;
+            }
+        }
+        
+        // Walk each member's neighbour list instead of testing every pair
+        for (size_t i = 0; i < vertices.size(); i++) {
+            int u = vertices[i];
+            if (u < 0 || u >= n) continue;
+            for (int v : neighborsOf(u)) {
+                if (v <= u) continue;
+                auto it = indexMap.find(v);
+                if (it != indexMap.end()) {
+                    subgraph.addEdge(i, it->second);
+                }
+            }
+        }
+        subgraph.finalize();
+        
+        return subgraph;
+    }
+};
+
+// A connected component of the h-clique graph, in which two vertices are
+// adjacent when some h-clique holds both. The densest subgraph lies inside
+// a single component, so each one is solved on its own flow network.
+struct CliqueComponent {
+    vector<int> vertices;
+    vector<int> cliques; // (h-1)-cliques extended by vertices of the component
+    long long hCliques = 0;
+    long long maxDegree = 0;
+    
+    // Whether some subset may be denser than c/k: none beats the largest
+    // h-clique degree, nor C/h since a set holding a clique has h vertices
+    bool mayBeat(long long c, long long k, int h) const {
+        return (__int128)maxDegree * k > c && (__int128)hCliques * k > (__int128)h * c;
+    }
+    
+    double upperBound(int h) const {
+        return min((double)maxDegree, (double)hCliques / h);
+    }
+};
+
+// Union-find over the vertices: every (h-1)-clique is joined with all of its
+// extensions. (h-1)-cliques without an extension belong to no component.
+vector<CliqueComponent> splitCliqueComponents(const Graph& G, int h, const CliqueStore& cliques) {
+    int n = G.getVertexCount();
+    vector<int> parent(n);
+    iota(parent.begin(), parent.end(), 0);
+    auto find = [&](int v) {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    };
+    
+    vector<int> anchor(cliques.size(), -1);
+    vector<int> extensions, scratch;
+    for (size_t i = 0; i < cliques.size(); i++) {
+        CliqueStore::Span clique = cliques[i];
+        G.commonNeighbors(clique.begin(), clique.size(), extensions, scratch);
+        if (extensions.empty()) continue;
+        
+        int root = find(extensions[0]);
+        for (int v : clique) {
+            int other = find(v);
+            if (other != root) parent[other] = root;
+        }
+        for (int v : extensions) {
+            int other = find(v);
+            if (other != root) parent[other] = root;
+        }
+        anchor[i] = extensions[0];
+    }
+    
+    vector<CliqueComponent> components;
+    vector<int> componentOf(n, -1);
+    for (int v = 0; v < n; v++) {
+        long long degree = G.cliqueDegree(v, h);
+        if (degree == 0) continue;
+        int root = find(v);
+        if (componentOf[root] < 0) {
+            componentOf[root] = components.size();
+            components.emplace_back();
+        }
+        CliqueComponent& component = components[componentOf[root]];
+        component.vertices.push_back(v);
+        component.hCliques += degree;
+        component.maxDegree = max(component.maxDegree, degree);
+    }
+    for (auto& component : components) {
+        component.hCliques /= h;
+    }
+    for (size_t i = 0; i < cliques.size(); i++) {
+        if (anchor[i] >= 0) {
+            components[componentOf[find(anchor[i])]].cliques.push_back(i);
+        }
+    }
+    return components;
+}
+
+// Densest set found so far, shared by the threads solving components
+struct DensestSet {
+    mutex lock;
+    vector<int> vertices;
+    long long cliques = 0;
+    long long size = 1;
+    
+    void read(long long& c, long long& k) {
+        lock_guard<mutex> hold(lock);
+        c = cliques;
+        k = size;
+    }
+    
+    // Keep candidate, holding inside h-cliques, if it is strictly denser
+    bool offer(const vector<int>& candidate, long long inside) {
+        lock_guard<mutex> hold(lock);
+        if ((__int128)inside * size <= (__int128)cliques * (long long)candidate.size()) return false;
+        vertices = candidate;
+        cliques = inside;
+        size = candidate.size();
+        return true;
+    }
+};
+
+// Solve one component against the shared best set and return the number
+// of flow solves. Dinkelbach steps start from the best density c/k known to
+// any thread, so a component that cannot beat it is closed by one cut.
+// certify is false when scaled capacities would overflow; bisect alone then
+// leaves the component within 1/h of its optimum.
+// localId must hold -1 for every vertex and is restored before returning.
+int solveCliqueComponent(const Graph& G, int h, const CliqueComponent& component, const CliqueStore& hMinus1Cliques,
+                         MaxFlowSolver& solver, bool bisect, bool certify, DensestSet& best, vector<int>& localId,
+                         Graph::SubsetScratch& subsetScratch, ostream& log) {
+    unique_ptr<PhaseClock> building(new PhaseClock(metrics.network, perfPhases.network));
+    int size = component.vertices.size();
+    for (int i = 0; i < size; i++) {
+        localId[component.vertices[i]] = i;
+    }
+    
+    size_t cliqueNodes = component.cliques.size();
+    int numNodes = 1 + size + cliqueNodes + 1;
+    FlowNetwork network(numNodes);
+    
+    // Every h-clique yields exactly h (clique, extension) pairs, so the arc
+    // count is known before building and the arrays are allocated only once
+    network.reserveArcs(2 * (size_t)size + (size_t)(h - 1) * cliqueNodes + (size_t)h * component.hCliques);
+    
+    int s = 0;
+    int t = numNodes - 1;
+    int vertexOffset = 1;
+    int cliqueOffset = vertexOffset + size;
+    
+    // Every h-clique of a vertex lies in its component, so the global clique
+    // degree is the right source capacity
+    vector<int> sourceArcs(size, -1);
+    vector<int> sinkArcs(size);
+    for (int i = 0; i < size; i++) {
+        sourceArcs[i] = network.addArc(s, vertexOffset + i, G.cliqueDegree(component.vertices[i], h));
+        sinkArcs[i] = network.addArc(vertexOffset + i, t, 0);
+    }
+    
+    vector<int> extensions, scratch;
+    for (size_t i = 0; i < cliqueNodes; i++) {
+        CliqueStore::Span clique = hMinus1Cliques[component.cliques[i]];
+        for (int v : clique) {
+            network.addArc(cliqueOffset + i, vertexOffset + localId[v], INF_CAPACITY);
+        }
+        G.commonNeighbors(clique.begin(), clique.size(), extensions, scratch);
+        for (int v : extensions) {
+            network.addArc(vertexOffset + localId[v], cliqueOffset + i, 1);
+        }
+    }
+    network.build();
+    building.reset();
+    metrics.flowNetworks++;
+    metrics.flowNodes += numNodes;
+    metrics.flowArcs += network.head.size() / 2;
+    log << "Component of " << size << " vertices and " << component.hCliques << " " << h << "-cliques: "
+        << numNodes << " nodes, " << network.head.size() / 2 << " arcs" << endl;
+    
+    int solves = 0;
+    vector<int> cut, D;
+    cut.reserve(numNodes);
+    D.reserve(size);
+    
+    // Source side of the last cut as original vertex ids
+    auto cutVertices = [&]() {
+        D.clear();
+        for (int node : cut) {
+            if (node >= vertexOffset && node < cliqueOffset) {
+                D.push_back(component.vertices[node - vertexOffset]);
+            }
+        }
+    };
+    
+    // Binary search on the sink capacity m, with s -> v at deg(v) and
+    // v -> clique at 1: the cut {s} is minimum exactly when nothing in the
+    // component is denser than m/h, so every step is exact. It stops within
+    // 1/h of the optimum, and the Dinkelbach steps below certify the result.
+    if (bisect) {
+        long long c, k;
+        best.read(c, k);
+        long long low = h * c / k;
+        long long high = min(h * component.maxDegree, component.hCliques);
+        
+        while (high - low > 1) {
+            solves++;
+            metrics.searchIterations++;
+            metrics.flowSolves++;
+            long long m = low + (high - low) / 2;
+            log << "Binary search step " << solves << ": α=" << m << "/" << h << " = " << fixed << setprecision(6)
+                << (double)m / h << " (sink capacity " << low << ".." << high << ")... " << flush;
+            
+            for (int i = 0; i < size; i++) {
+                solver.setSinkCapacity(network, sinkArcs[i], m);
+            }
+            
+            // Later iterations may reuse the previous flow state
+            {
+                PhaseClock clock(metrics.flow, perfPhases.flow);
+                if (solves == 1) {
+                    solver.minCut(network, s, t, cut);
+                } else {
+                    solver.resolve(network, s, t, cut);
+                }
+            }
+            
+            cutVertices();
+            if (D.empty()) {
+                high = m;
+                log << "cut contains only s, nothing is denser" << endl;
+                continue;
+            }
+            
+            long long inside = G.countCliquesInside(D, h, subsetScratch);
+            best.offer(D, inside);
+            best.read(c, k);
+            low = max(m, h * c / k);
+            log << "cut contains " << D.size() << " vertices with density " << (double)inside / D.size() << endl;
+        }
+    }
+    
+    while (certify) {
+        long long c, k;
+        best.read(c, k);
+        if (!component.mayBeat(c, k, h)) {
+            log << "Component bound " << component.upperBound(h) << " no longer beats " << c << "/" << k << endl;
+            break;
+        }
+        long long g = gcd(c, k);
+        c /= g;
+        k /= g;
+        solves++;
+        metrics.searchIterations++;
+        metrics.flowSolves++;
+        log << "Dinkelbach step " << solves << ": α=" << c << "/" << k << " = "
+            << fixed << setprecision(6) << (double)c / k << "... " << flush;
+        
+        // s -> v: k * deg(v), v -> clique: k, v -> t: h * c; the cut of a
+        // source side S' then costs k*h*C - h*(k*C(S') - c*|S'|)
+        for (int i = 0; i < size; i++) {
+            network.capacity[sourceArcs[i]] = k * G.cliqueDegree(component.vertices[i], h);
+            network.capacity[sinkArcs[i]] = h * c;
+        }
+        for (size_t e = 0; e < network.head.size(); e += 2) {
+            int from = network.tailOf(e);
+            if (from >= vertexOffset && from < cliqueOffset && network.head[e] >= cliqueOffset && network.head[e] != t) {
+                network.capacity[e] = k;
+            }
+        }
+        
+        // Every capacity changes with k, so each step solves from zero flow
+        Capacity cutValue;
+        {
+            PhaseClock clock(metrics.flow, perfPhases.flow);
+            cutValue = solver.minCut(network, s, t, cut);
+        }
+        Capacity trivialCut = (Capacity)k * h * component.hCliques;
+        if (cutValue >= trivialCut) {
+            log << "Certified: minimum cut " << cutValue << " equals the cut {s} = " << k << "*" << h << "*"
+                << component.hCliques << ", so nothing in this component beats " << c << "/" << k << endl;
+            break;
+        }
+        
+        // A cut below k*h*C guarantees a strictly denser source side
+        cutVertices();
+        long long inside = D.empty() ? 0 : G.countCliquesInside(D, h, subsetScratch);
+        if (D.empty() || (__int128)inside * k <= (__int128)c * (long long)D.size()) {
+            log << "Cut " << cutValue << " below " << trivialCut << " but its source side is not denser; stopping" << endl;
+            break;
+        }
+        best.offer(D, inside);
+        log << "cut " << cutValue << " < " << trivialCut << ", denser set of " << D.size() << " vertices" << endl;
+    }
+    
+    for (int v : component.vertices) {
+        localId[v] = -1;
+    }
+    return solves;
+}
+
+// Find the Clique Densest Subgraph with memory optimizations. The graph is
+// split into clique-connected components; each is bounded by its largest
+// h-clique degree and its clique count, and the components that may still
+// beat the best density are solved concurrently. The default search is
+// Dinkelbach's: α is always the exact density c/k of a known set, every
+// capacity is scaled by k so the network stays integral, and a component
+// is closed once its trivial cut {s} is minimum, which proves nothing in it
+// is denser. bisect first binary-searches the integral sink capacity to
+// within 1/h of the optimum and then certifies with the same steps.
+Graph findCliqueDenseSubgraph(const Graph& G, int h, MaxFlowSolver& solver, bool bisect) {
+    int n = G.getVertexCount();
+    cout << "Analyzing graph with " << n << " vertices for " << h << "-clique densest subgraph" << endl;
+    
+    if (n <= 0) {
+        cerr << "Empty graph, nothing to analyze." << endl;
+        return G;
+    }
+    
+    // Find the maximum clique degree to set upper bound
+    cout << "Finding maximum " << h << "-clique degree... " << flush;
+    long long maxCliqueDegree = G.findMaxCliqueDegree(h);
+    cout << "Max degree: " << maxCliqueDegree << endl;
+    
+    if (maxCliqueDegree == 0) {
+        cout << "No " << h << "-cliques found in the graph. Try a smaller h value." << endl;
+        return G;  // Return original graph if no h-cliques exist
+    }
+    
+    // Cache all necessary cliques
+    const auto& hMinus1Cliques = G.getHMinus1Cliques(h);
+    
+    if (G.countCliques(h) == 0 || (h > 1 && hMinus1Cliques.empty())) {
+        cout << "Not enough cliques found for analysis." << endl;
+        return G;
+    }
+    
+    // Scaled capacities reach k * h * C(V) <= n * h * C(V); past INF_CAPACITY
+    // the network would no longer be exact, and the binary search alone ends
+    // within 1/h of the optimum without a certificate
+    bool certify = (double)n * h * G.countCliques(h) < (double)INF_CAPACITY / 2;
+    if (!certify) {
+        cout << "Scaled capacities would overflow, falling back to binary search without certification" << endl;
+        bisect = true;
+    }
+    
+    cout << "Splitting into clique-connected components... " << flush;
+    vector<CliqueComponent> components;
+    {
+        PhaseClock clock(metrics.network, perfPhases.network);
+        components = splitCliqueComponents(G, h, hMinus1Cliques);
+    }
+    cout << components.size() << " components" << endl;
+    
+    // The densest whole component is the first lower bound
+    DensestSet best;
+    for (const auto& component : components) {
+        if ((__int128)component.hCliques * best.size > (__int128)best.cliques * (long long)component.vertices.size()) {
+            best.vertices = component.vertices;
+            best.cliques = component.hCliques;
+            best.size = component.vertices.size();
+        }
+    }
+    
+    // Strongest bounds first: they are the likeliest to raise the lower bound
+    // and so let the weaker components be skipped
+    sort(components.begin(), components.end(), [h](const CliqueComponent& a, const CliqueComponent& b) {
+        return a.upperBound(h) > b.upperBound(h);
+    });
+    
+    int workers = max(1, min(G.getThreadCount(), (int)components.size()));
+    vector<unique_ptr<MaxFlowSolver>> solvers(workers);
+    vector<vector<int>> localIds(workers);
+    vector<Graph::SubsetScratch> subsetScratch(workers);
+    
+    // Owners pop from the back of their deques: queue the weakest first so
+    // that every worker starts on its strongest component
+    StealingPool<int> pool(workers);
+    for (int i = (int)components.size() - 1; i >= 0; i--) {
+        pool.push(i % workers, i);
     }
     
-    // Initialize cache of h-cliques and their membership map
-    void initializeCliqueCache(int h) const {
-        if (cacheInitialized) return;
-        
-        cout << "Precomputing cliques for h=" << h << "..." << flush;
-        auto start = chrono::high_resolution_clock::now();
+    mutex outputLock;
+    atomic<int> solved{0};
+    atomic<long long> flowSolves{0};
+    pool.run([&](int i, int worker) {
+        const CliqueComponent& component = components[i];
+        long long c, k;
+        best.read(c, k);
+        if (!component.mayBeat(c, k, h)) {
+            metrics.componentsSkipped++;
+            return;
+        }
+        metrics.componentsSolved++;
         
-        hCliquesCache.clear();
-        hMinus1CliquesCache.clear();
-        vertexToCliqueMap.resize(n);
+        if (!solvers[worker]) {
+            solvers[worker] = solver.clone();
+            localIds[worker].assign(n, -1);
+        }
         
-        // Find cliques using iterative approach to avoid stack overflow
+        // Threads buffer their messages so that components do not interleave;
+        // a stream without a buffer discards everything in quiet mode
+        ostringstream buffer;
+        ostream discard(nullptr);
+        ostream& log = quietMode ? discard : workers > 1 ? static_cast<ostream&>(buffer) : cout;
+        solvers[worker]->setLog(log);
         try {
-            findCliquesIterative(h, hCliquesCache);
-            
-            if (h > 1) {
-                findCliquesIterative(h-1, hMinus1CliquesCache);
-            }
-            
-            // Build mapping from vertices to cliques they belong to
-            for (size_t i = 0; i < hCliquesCache.size(); i++) {
-                for (int v : hCliquesCache[i]) {
-                    if (v >= 0 && v < n) {
-                        vertexToCliqueMap[v].push_back(i);
-                    }
-                }
-            }
-            
-            auto end = chrono::high_resolution_clock::now();
-            auto duration = chrono::duration_cast<chrono::milliseconds>(end - start).count();
-            
-            cout << " Done! Found " << hCliquesCache.size() << " h-cliques and " 
-                 << hMinus1CliquesCache.size() << " (h-1)-cliques in " << duration << "ms" << endl;
-            
-            cacheInitialized = true;
+            flowSolves += solveCliqueComponent(G, h, component, hMinus1Cliques, *solvers[worker], bisect, certify,
+                                               best, localIds[worker], subsetScratch[worker], log);
         }
         catch (const exception& e) {
-            cout << "Error in clique computation: " << e.what() << endl;
-            // Return with empty caches
-            hCliquesCache.clear();
-            hMinus1CliquesCache.clear();
+            log << "Error while solving a component: " << e.what() << endl;
+            log << "Using best subgraph found so far..." << endl;
         }
+        solved++;
+        if (workers > 1 && !quietMode) {
+            lock_guard<mutex> hold(outputLock);
+            cout << buffer.str() << flush;
+        }
+    });
+    
+    long long g = gcd(best.cliques, best.size);
+    cout << "Solved " << solved << " of " << components.size() << " components, the rest could not beat the best density ("
+         << flowSolves << " flow solves; " << pool.summary() << ")" << endl;
+    if (!certify) {
+        cout << "\nBinary search complete. Density " << (double)best.cliques / best.size << " is within 1/" << h
+             << " of optimal (not certified)" << endl;
+    } else {
+        cout << "Every component was certified or bounded, so the optimal density is "
+             << best.cliques / g << "/" << best.size / g << " = " << fixed << setprecision(6)
+             << (double)best.cliques / best.size << endl;
     }
     
-    // Get all h-cliques
-    const vector<vector<int>>& getHCliques(int h) const {
-        initializeCliqueCache(h);
-        return hCliquesCache;
+    return G.getInducedSubgraph(best.vertices);
+}
+
+// Greedy peeling (--mode=peel): repeatedly delete a vertex of minimum
+// h-clique degree and keep the densest remaining set. That set is within a
+// factor h of the optimum, and the largest minimum degree met while peeling
+// (the maximum clique-core number) is a certified upper bound: every vertex
+// of an optimal set has at least the optimal density as its degree inside it.
+Graph peelCliqueDenseSubgraph(const Graph& G, int h) {
+    int n = G.getVertexCount();
+    cout << "Peeling " << n << " vertices by " << h << "-clique degree" << endl;
+    
+    if (n <= 0) {
+        cerr << "Empty graph, nothing to analyze." << endl;
+        return G;
     }
     
-    // Get all (h-1)-cliques
-    const vector<vector<int>>& getHMinus1Cliques(int h) const {
-        initializeCliqueCache(h);
-        return hMinus1CliquesCache;
+    // Only per-vertex counts are needed; no (h-1)-cliques are stored
+    cout << "Counting " << h << "-cliques per vertex... " << flush;
+    vector<long long> cliqueDegree;
+    long long remaining;
+    {
+        PhaseClock clock(metrics.cliques, perfPhases.cliques);
+        remaining = G.countCliquesPerVertex(h, cliqueDegree);
     }
+    metrics.cliquesListed += remaining;
+    cout << remaining << " cliques" << endl;
     
-    // Calculate clique degree of a vertex
-    int cliqueDegree(int v, int h) const {
-        if (v < 0 || v >= n) return 0;
-        initializeCliqueCache(h);
-        return vertexToCliqueMap[v].size();
+    if (remaining == 0) {
+        cout << "No " << h << "-cliques found in the graph. Try a smaller h value." << endl;
+        return G;
     }
     
-    // Find maximum clique degree
-    int findMaxCliqueDegree(int h) const {
-        initializeCliqueCache(h);
-        
-        int maxDegree = 0;
-        for (int v = 0; v < n; v++) {
-            maxDegree = max(maxDegree, static_cast<int>(vertexToCliqueMap[v].size()));
+    // Bucket queue: a doubly linked list of vertices per clique degree.
+    // Degrees only fall, and the scan position follows them down.
+    long long maxDegree = *max_element(cliqueDegree.begin(), cliqueDegree.end());
+    vector<int> bucketHead(maxDegree + 1, -1), nextInBucket(n), prevInBucket(n);
+    auto link = [&](int v) {
+        long long d = cliqueDegree[v];
+        prevInBucket[v] = -1;
+        nextInBucket[v] = bucketHead[d];
+        if (bucketHead[d] >= 0) prevInBucket[bucketHead[d]] = v;
+        bucketHead[d] = v;
+    };
+    auto unlink = [&](int v) {
+        if (prevInBucket[v] >= 0) {
+            nextInBucket[prevInBucket[v]] = nextInBucket[v];
+        } else {
+            bucketHead[cliqueDegree[v]] = nextInBucket[v];
         }
-        return maxDegree;
+        if (nextInBucket[v] >= 0) prevInBucket[nextInBucket[v]] = prevInBucket[v];
+    };
+    for (int v = 0; v < n; v++) {
+        link(v);
     }
     
-    // Count h-cliques in the graph
-    int countCliques(int h) const {
-        initializeCliqueCache(h);
-        return hCliquesCache.size();
-    }
+    vector<char> alive(n, 1);
+    vector<int> peelOrder;
+    peelOrder.reserve(n);
+    Graph::SubsetScratch scratch;
     
-    // Calculate h-clique density
-    double cliqueDensity(int h) const {
-        int cliqueCount = countCliques(h);
-        if (n == 0) return 0.0;
-        return static_cast<double>(cliqueCount) / n;
-    }
+    long long level = 0;
+    long long coreBound = 0;
+    double bestDensity = (double)remaining / n;
+    int bestStep = 0; // vertices peeled before the densest set
     
-    // Get induced subgraph
-    Graph getInducedSubgraph(const vector<int>& vertices) const {
-        Graph subgraph(vertices.size());
-        unordered_map<int, int> indexMap;
+    for (int step = 0; step < n; step++) {
+        while (bucketHead[level] < 0) level++;
+        int u = bucketHead[level];
+        unlink(u);
+        alive[u] = 0;
+        peelOrder.push_back(u);
+        coreBound = max(coreBound, level);
         
-        for (size_t i = 0; i < vertices.size(); i++) {
-            if (vertices[i] >= 0 && vertices[i] < n) {
-                indexMap[vertices[i]] = i;
+        // Every live clique through u disappears with it
+        G.forEachCliqueAround(u, h, alive, scratch, [&](const int* others) {
+            for (int i = 0; i < h - 1; i++) {
+                int w = others[i];
+                unlink(w);
+                cliqueDegree[w]--;
+                link(w);
+                level = min(level, cliqueDegree[w]);
             }
-        }
+        });
+        remaining -= cliqueDegree[u];
         
-        for (size_t i = 0; i < vertices.size(); i++) {
-            for (size_t j = i + 1; j < vertices.size(); j++) {
-                int u = vertices[i];
-                int v = vertices[j];
-                if (u >= 0 && u < n && v >= 0 && v < n && hasEdge(u, v)) {
-                    subgraph.addEdge(indexMap[u], indexMap[v]);
-                }
-            }
+        int left = n - step - 1;
+        if (left > 0 && (double)remaining / left > bestDensity) {
+            bestDensity = (double)remaining / left;
+            bestStep = step + 1;
         }
-        
-        return subgraph;
     }
-};
+    
+    cout << "Densest peeled set: " << n - bestStep << " vertices, density " << bestDensity << endl;
+    cout << "Certified upper bound on the optimum: " << coreBound
+         << " (approximation ratio at least " << bestDensity / coreBound << ", guaranteed 1/" << h << ")" << endl;
+    
+    vector<int> best(peelOrder.begin() + bestStep, peelOrder.end());
+    sort(best.begin(), best.end());
+    return G.getInducedSubgraph(best);
+}
 
-// Dinic's algorithm for maximum flow
-int dinicMaxFlow(const vector<vector<int>>& capacity, int s, int t, vector<int>& minCut) {
-    int n = capacity.size();
-    if (s < 0 || s >= n || t < 0 || t >= n) {
-        cerr << "Invalid source or sink in flow network" << endl;
-        return 0;
+// Frank-Wolfe over clique-to-vertex assignments (--mode=iterative). The
+// load b(v) is the share of h-cliques currently assigned to v. Each pass is
+// one parallel sweep over the h-cliques that moves every clique towards its
+// least-loaded vertex, stepping as far as minimises sum b(v)^2, whose
+// minimiser yields the densest subgraph. The same sweep counts cliques by
+// their lowest-ranked vertex when vertices are ranked by load, giving the
+// density of every top-k prefix. The best prefix is the lower bound and
+// max b(v) the upper bound: the cliques inside any set S are assigned
+// within S, so some vertex of S carries at least the density of S. Stops
+// once (upper - lower) / upper <= gapTarget or after maxPasses passes.
+Graph iterateCliqueDenseSubgraph(const Graph& G, int h, double gapTarget, int maxPasses) {
+    int n = G.getVertexCount();
+    cout << "Frank-Wolfe iterations on " << h << "-clique loads (gap " << gapTarget << ", at most " << maxPasses << " passes)" << endl;
+    
+    if (n <= 0) {
+        cerr << "Empty graph, nothing to analyze." << endl;
+        return G;
     }
     
-    vector<vector<int>> flow(n, vector<int>(n, 0));
-    vector<int> level(n);
-    vector<int> ptr(n);
+    int workers = max(1, G.getThreadCount());
+    vector<double> load(n, 0);
+    vector<int> order(n), rank(n);
+    vector<vector<long long>> chosen(workers), lowestRank(workers);
+    vector<long long> targets(n), byRank(n);
     
-    // BFS to create level graph
-    auto bfs = [&]() -> bool {
-        fill(level.begin(), level.end(), -1);
-        level[s] = 0;
+    double lower = 0, upper = numeric_limits<double>::infinity();
+    int bestSize = 0;
+    vector<int> best;
+    
+    for (int pass = 0; pass < maxPasses; pass++) {
+        // Rank by current load, heaviest first
+        for (int v = 0; v < n; v++) {
+            order[v] = v;
+        }
+        sort(order.begin(), order.end(), [&](int a, int b) {
+            return load[a] != load[b] ? load[a] > load[b] : a < b;
+        });
+        for (int i = 0; i < n; i++) {
+            rank[order[i]] = i;
+        }
         
-        queue<int> q;
-        q.push(s);
+        for (int w = 0; w < workers; w++) {
+            chosen[w].assign(n, 0);
+            lowestRank[w].assign(n, 0);
+        }
+        {
+            PhaseClock clock(metrics.cliques, perfPhases.cliques);
+            G.forEachCliqueOnWorkers(h, [&](int worker) {
+                vector<long long>* target = &chosen[worker];
+                vector<long long>* last = &lowestRank[worker];
+                const vector<double>* b = &load;
+                const vector<int>* position = &rank;
+                return [target, last, b, position, h](const int* clique) {
+                    int lightest = clique[0];
+                    int deepest = (*position)[clique[0]];
+                    for (int i = 1; i < h; i++) {
+                        int v = clique[i];
+                        if ((*b)[v] < (*b)[lightest] || ((*b)[v] == (*b)[lightest] && v < lightest)) lightest = v;
+                        deepest = max(deepest, (*position)[v]);
+                    }
+                    (*target)[lightest]++;
+                    (*last)[deepest]++;
+                };
+            });
+        }
         
-        while (!q.empty()) {
-            int u = q.front();
-            q.pop();
-            
-            for (int v = 0; v < n; v++) {
-                if (level[v] < 0 && capacity[u][v] > flow[u][v]) {
-                    level[v] = level[u] + 1;
-                    q.push(v);
-                }
+        // Merge the per-worker sums; both are exact integers, so the result
+        // does not depend on how cliques were spread over threads
+        long long total = 0;
+        for (int v = 0; v < n; v++) {
+            targets[v] = 0;
+            byRank[v] = 0;
+            for (int w = 0; w < workers; w++) {
+                targets[v] += chosen[w][v];
+                byRank[v] += lowestRank[w][v];
             }
+            total += byRank[v];
+        }
+        metrics.cliquesListed += total;
+        if (total == 0) {
+            cout << "No " << h << "-cliques found in the graph. Try a smaller h value." << endl;
+            return G;
         }
         
-        return level[t] >= 0;
-    };
-    
-    // DFS to find blocking flow
-    function<int(int, int)> dfs = [&](int u, int flowCap) -> int {
-        if (u == t) return flowCap;
-        
-        for (int& i = ptr[u]; i < n; i++) {
-            int v = i;
-            if (level[v] == level[u] + 1 && capacity[u][v] > flow[u][v]) {
-                int bottleneck = dfs(v, min(flowCap, capacity[u][v] - flow[u][v]));
-                if (bottleneck > 0) {
-                    flow[u][v] += bottleneck;
-                    flow[v][u] -= bottleneck;
-                    return bottleneck;
-                }
+        // Primal: densest prefix of the ranking that was just swept
+        long long inside = 0;
+        for (int k = 1; k <= n; k++) {
+            inside += byRank[k - 1];
+            if ((double)inside / k > lower) {
+                lower = (double)inside / k;
+                bestSize = k;
+                best.assign(order.begin(), order.begin() + k);
             }
         }
         
-        return 0;
-    };
-    
-    int maxFlow = 0;
-    int dinicIterations = 0;
-    cout << "Running Dinic's max-flow algorithm: " << flush;
-    
-    // Main Dinic's algorithm loop
-    while (bfs()) {
-        dinicIterations++;
-        if (dinicIterations % 10 == 0) {
-            cout << "." << flush;
+        // Frank-Wolfe step towards the all-to-the-lightest assignment, with
+        // the exact line search for the objective sum of b(v)^2
+        double dot = 0, distance = 0;
+        for (int v = 0; v < n; v++) {
+            double diff = load[v] - targets[v];
+            dot += load[v] * diff;
+            distance += diff * diff;
         }
-        
-        fill(ptr.begin(), ptr.end(), 0);
-        while (int pushed = dfs(s, numeric_limits<int>::max())) {
-            maxFlow += pushed;
+        double step = (pass == 0 || distance == 0) ? 1.0 : min(1.0, max(0.0, dot / distance));
+        double heaviest = 0;
+        for (int v = 0; v < n; v++) {
+            load[v] = (1 - step) * load[v] + step * targets[v];
+            heaviest = max(heaviest, load[v]);
         }
-    }
-    
-    cout << " Done!" << endl;
-    
-    // Find min-cut
-    vector<bool> visited(n, false);
-    queue<int> q;
-    q.push(s);
-    visited[s] = true;
-    
-    while (!q.empty()) {
-        int u = q.front();
-        q.pop();
+        upper = min(upper, heaviest);
         
-        for (int v = 0; v < n; v++) {
-            if (capacity[u][v] > flow[u][v] && !visited[v]) {
-                visited[v] = true;
-                q.push(v);
-            }
+        double gap = (upper - lower) / upper;
+        
+        // Quiet mode reports only the last pass
+        if (!quietMode || gap <= gapTarget || pass + 1 == maxPasses) {
+            cout << "Pass " << pass + 1 << ": density " << lower << " on " << bestSize << " vertices, upper bound "
+                 << upper << ", gap " << 100 * gap << "%" << endl;
         }
+        if (gap <= gapTarget) break;
     }
     
-    minCut.clear();
-    for (int i = 0; i < n; i++) {
-        if (visited[i]) {
-            minCut.push_back(i);
-        }
+    sort(best.begin(), best.end());
+    return G.getInducedSubgraph(best);
+}
+
+// Write G and the original ids as the dataset's snapshot
+bool writeSnapshot(const string& path, const struct stat& source, const Graph& G, const vector<int>& originalId) {
+    SnapshotView view;
+    view.vertexCount = G.getVertexCount();
+    view.adjacencyEntries = G.adjacency().size();
+    view.dagEntries = G.dagAdjacency().size();
+    view.degeneracy = G.getDegeneracy();
+    for (int u = 0; u < G.getVertexCount(); u++) {
+        view.maxDegree = max<int64_t>(view.maxDegree, G.degree(u));
     }
-    
-    return maxFlow;
+    view.rowOffsets = G.adjacencyOffsets().data();
+    view.rowNeighbors = G.adjacency().data();
+    view.dagOffsets = G.dagOffsets().data();
+    view.dagNeighbors = G.dagAdjacency().data();
+    view.originalIds = originalId.data();
+    return writeSnapshotFile(path, source, view);
 }
 
-// Find the Clique Densest Subgraph with memory optimizations
-Graph findCliqueDenseSubgraph(const Graph& G, int h) {
-    int n = G.getVertexCount();
-    cout << "Analyzing graph with " << n << " vertices for " << h << "-clique densest subgraph" << endl;
+// Map a snapshot and build the graph on top of it without copying. Fails
+// (and the caller parses the text instead) when mapSnapshotFile rejects it.
+bool openSnapshot(const string& path, const struct stat& source, unique_ptr<Graph>& graph, IntArray& originalId) {
+    shared_ptr<MappedFile> file;
+    SnapshotView view;
+    if (!mapSnapshotFile(path, source, file, view)) return false;
     
-    if (n <= 0) {
-        cerr << "Empty graph, nothing to analyze." << endl;
-        return G;
+    int n = view.vertexCount;
+    graph.reset(new Graph(n));
+    graph->attach(file, view.rowOffsets, view.rowNeighbors, view.dagOffsets, view.dagNeighbors, view.degeneracy);
+    originalId.borrow(file, view.originalIds, n);
+    cout << "Opened snapshot " << path << ": " << n << " vertices, " << view.adjacencyEntries / 2
+         << " edges, max degree " << view.maxDegree << ", degeneracy " << view.degeneracy << endl;
+    return true;
+}
+
+// Load the graph from its snapshot when one is current, otherwise parse the
+// text (or stdin when there is no such file) and leave a snapshot behind
+bool loadGraph(const string& filename, int threads, unique_ptr<Graph>& graph, IntArray& originalId) {
+    struct stat source;
+    bool haveFile = !filename.empty() && stat(filename.c_str(), &source) == 0;
+    string snapshotPath = filename + ".csr";
+    if (haveFile && openSnapshot(snapshotPath, source, graph, originalId)) {
+        return true;
     }
     
-    // Find the maximum clique degree to set upper bound
-    cout << "Finding maximum " << h << "-clique degree... " << flush;
-    int maxCliqueDegree = G.findMaxCliqueDegree(h);
-    cout << "Max degree: " << maxCliqueDegree << endl;
-    
-    if (maxCliqueDegree == 0) {
-        cout << "No " << h << "-cliques found in the graph. Try a smaller h value." << endl;
-        return G;  // Return original graph if no h-cliques exist
+    // The edge list is mapped straight from disk; without a file the rest
+    // of stdin is taken as the edge list
+    MappedFile mapped;
+    string stdinText;
+    EdgeList input;
+    if (haveFile && mapped.open(filename)) {
+        input = parseEdgeList(mapped.data(), mapped.size(), threads);
+    } else {
+        haveFile = false;
+        cout << "File not found, reading from stdin..." << endl;
+        stdinText.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+        input = parseEdgeList(stdinText.data(), stdinText.size(), threads);
     }
     
-    // Cache all necessary cliques
-    const auto& hCliques = G.getHCliques(h);
-    const auto& hMinus1Cliques = G.getHMinus1Cliques(h);
-    
-    if (hCliques.empty() || (h > 1 && hMinus1Cliques.empty())) {
-        cout << "Not enough cliques found for analysis." << endl;
-        return G;
+    int n = input.originalId.size();
+    long long m = input.edges.size();
+    if (n <= 0) {
+        cerr << "No edges found in the input" << endl;
+        return false;
     }
     
-    // Initialize binary search bounds
-    double l = 0;
-    double u = maxCliqueDegree;
-    double precision = 1.0 / (n * n);  // Relaxed precision for large graphs
-    
-    vector<int> D; // Current densest subgraph
-    vector<int> bestD; // Best subgraph found so far
-    double bestDensity = 0;
+    if (n > 1000000) {
+        cerr << "Graph too large! Maximum supported size is 1,000,000 vertices." << endl;
+        return false;
+    }
     
-    // Binary search for optimal density
-    int iterCount = 0;
-    cout << "Binary search progress: " << flush;
+    if (input.malformedLines > 0) {
+        cerr << "Warning: " << input.malformedLines << " malformed lines were ignored" << endl;
+    }
+    if (input.selfLoops > 0) {
+        cerr << "Warning: " << input.selfLoops << " self-loops were ignored" << endl;
+    }
+    if (n != input.declaredVertices || m != input.declaredEdges) {
+        cout << "Header declares " << input.declaredVertices << " vertices and " << input.declaredEdges
+             << " edges; using the " << n << " vertices and " << m << " edge lines actually present" << endl;
+    }
     
-    // Limit binary search iterations for very large graphs
-    const int MAX_ITERATIONS = 20;
+    cout << "Creating graph with " << n << " vertices and " << m << " edges..." << endl;
+    graph.reset(new Graph(n));
+    graph->setEdges(move(input.edges));
     
-    try {
-        while (u - l >= precision && iterCount < MAX_ITERATIONS) {
-            iterCount++;
-            double progress = (u - l) / maxCliqueDegree * 100.0;
-            
-            cout << "\rBinary search: " << fixed << setprecision(1) << (100.0 - progress) << "% (α=" << l << ".." << u << ") " << flush;
-            
-            double alpha = (l + u) / 2;
-            
-            // Build sparse flow network
-            cout << "\nBuilding flow network for α=" << alpha << "... " << flush;
-            
-            // Use bounds checking for sizes
-            size_t numNodes = 1 + n + min(hMinus1Cliques.size(), (size_t)100000) + 1; // Limit cliques processed
-            
-            if (numNodes > 1000000) {
-                cout << "Flow network too large (" << numNodes << " nodes). Using sampling approach." << endl;
-                numNodes = 1000000;  // Limit network size
-            }
-            
-            // Use sparse representation for large graphs
-            vector<vector<pair<int, int>>> sparseCapacity(numNodes);
-            
-            int s = 0;
-            int t = numNodes - 1;
-            int vertexOffset = 1;
-            int cliqueOffset = vertexOffset + n;
-            
-            // Add edges from s to vertices
-            for (int v = 0; v < n; v++) {
-                int cap = G.cliqueDegree(v, h);
-                if (cap > 0) {
-                    sparseCapacity[s].push_back({vertexOffset + v, cap});
-                }
-            }
-            
-            // Add edges from vertices to t
-            for (int v = 0; v < n; v++) {
-                sparseCapacity[vertexOffset + v].push_back({t, ceil(alpha * h)});
-            }
-            
-            // Add edges from vertices to (h-1)-cliques and from (h-1)-cliques to vertices
-            cout << "Building flow network edges... " << flush;
-            
-            // Always use sampling approach for large graphs
-            const size_t MAX_CLIQUES_TO_PROCESS = min(hMinus1Cliques.size(), (size_t)10000);
-            
-            cout << "Processing " << MAX_CLIQUES_TO_PROCESS << " of " 
-                 << hMinus1Cliques.size() << " cliques..." << endl;
-            
-            for (size_t i = 0; i < MAX_CLIQUES_TO_PROCESS && i < hMinus1Cliques.size(); i++) {
-                if (cliqueOffset + i >= numNodes) break;  // Safety check
-                
-                const auto& clique = hMinus1Cliques[i];
-                
-                // Add edges from (h-1)-cliques to vertices
-                for (int v : clique) {
-                    if (v >= 0 && v < n && vertexOffset + v < numNodes) {
-                        sparseCapacity[cliqueOffset + i].push_back({vertexOffset + v, numeric_limits<int>::max()});
-                    }
-                }
-                
-                // Add edges from vertices to (h-1)-cliques (sampling)
-                for (int v = 0; v < n; v++) {
-                    if (find(clique.begin(), clique.end(), v) != clique.end()) continue;
-                    
-                    bool canExtend = true;
-                    for (int u : clique) {
-                        if (!G.hasEdge(v, u)) {
-                            canExtend = false;
-                            break;
-                        }
-                    }
-                    
-                    if (canExtend && vertexOffset + v < numNodes && cliqueOffset + i < numNodes) {
-                        sparseCapacity[vertexOffset + v].push_back({cliqueOffset + i, 1});
-                    }
-                }
-            }
-            
-            // Use more memory-efficient approach for very large networks
-            vector<vector<int>> capacity;
-            
-            if (numNodes > 100000) {
-                cout << "Using sparse max-flow implementation for large network..." << endl;
-                // Create a smaller network with only active nodes
-                unordered_set<int> activeNodes;
-                activeNodes.insert(s);
-                activeNodes.insert(t);
-                
-                for (int u = 0; u < numNodes; u++) {
-                    if (!sparseCapacity[u].empty()) {
-                        activeNodes.insert(u);
-                        for (const auto& edge : sparseCapacity[u]) {
-                            activeNodes.insert(edge.first);
-                        }
-                    }
-                }
-                
-                // Create mapping to compact indices
-                unordered_map<int, int> nodeMap;
-                int idx = 0;
-                for (int node : activeNodes) {
-                    nodeMap[node] = idx++;
-                }
-                
-                // Create compact capacity matrix
-                capacity.resize(idx, vector<int>(idx, 0));
-                for (int u = 0; u < numNodes; u++) {
-                    if (activeNodes.find(u) != activeNodes.end()) {
-                        for (const auto& edge : sparseCapacity[u]) {
-                            if (activeNodes.find(edge.first) != activeNodes.end()) {
-                                capacity[nodeMap[u]][nodeMap[edge.first]] = edge.second;
-                            }
-                        }
-                    }
-                }
-                
-                // Update s and t to new indices
-                s = nodeMap[s];
-                t = nodeMap[t];
-            } else {
-                // Regular approach for smaller networks
-                capacity.resize(numNodes, vector<int>(numNodes, 0));
-                for (int u = 0; u < numNodes; u++) {
-                    for (const auto& edge : sparseCapacity[u]) {
-                        capacity[u][edge.first] = edge.second;
-                    }
-                }
-            }
-            
-            // Free memory
-            sparseCapacity.clear();
-            
-            // Find min-cut
-            vector<int> minCut;
-            dinicMaxFlow(capacity, s, t, minCut);
+    if (haveFile) {
+        if (writeSnapshot(snapshotPath, source, *graph, input.originalId)) {
+            cout << "Wrote snapshot " << snapshotPath << endl;
+        } else {
+            cerr << "Warning: could not write snapshot " << snapshotPath << endl;
+        }
+    }
+    originalId.adopt(move(input.originalId));
+    return true;
+}
 
-            
-            // Free memory
-            capacity.clear();
-            
-            if (minCut.size() <= 1) { // Only s is in the cut
-                u = alpha;
-                cout << "Cut contains only source. Reducing upper bound to " << u << endl;
-            } else {
-                l = alpha;
-                
-                // For large networks with remapped nodes, we need to convert back
-                // This is a simplified version for the general case
-                
-                // Extract vertices from the cut (excluding s)
-                D.clear();
-                for (int node : minCut) {
-                    if (node != s && node >= vertexOffset && node < cliqueOffset) {
-                        int originalVertex = node - vertexOffset;
-                        if (originalVertex >= 0 && originalVertex < n) {
-                            D.push_back(originalVertex);
-                        }
-                    }
-                }
-                
-                // Update best subgraph if this one is non-empty
-                if (!D.empty()) {
-                    // Compute actual density (optional for large graphs)
-                    if (D.size() < 1000) {
-                        Graph subgraph = G.getInducedSubgraph(D);
-                        double density = subgraph.cliqueDensity(h);
-                        if (density > bestDensity) {
-                            bestDensity = density;
-                            bestD = D;
-                        }
-                        cout << "Cut contains " << D.size() << " vertices with density " << density << ". Increasing lower bound to " << l << endl;
-                    } else {
-                        bestD = D;
-                        cout << "Cut contains " << D.size() << " vertices. Increasing lower bound to " << l << endl;
-                    }
-                }
-            }
+// Clique sizes from --h=: a range "2..8" or a list "3,5,7", returned sorted
+// and without repeats; false when the text holds no valid size
+bool parseCliqueSizes(const string& text, vector<int>& sizes) {
+    sizes.clear();
+    size_t dots = text.find("..");
+    if (dots != string::npos) {
+        int first = atoi(text.substr(0, dots).c_str());
+        int last = atoi(text.substr(dots + 2).c_str());
+        for (int h = first; h <= last; h++) {
+            sizes.push_back(h);
+        }
+    } else {
+        size_t start = 0;
+        while (start <= text.size()) {
+            size_t comma = text.find(',', start);
+            if (comma == string::npos) comma = text.size();
+            sizes.push_back(atoi(text.substr(start, comma - start).c_str()));
+            start = comma + 1;
         }
     }
-    catch (const exception& e) {
-        cout << "Error during binary search: " << e.what() << endl;
-        cout << "Using best subgraph found so far..." << endl;
+    sort(sizes.begin(), sizes.end());
+    sizes.erase(unique(sizes.begin(), sizes.end()), sizes.end());
+    return !sizes.empty() && sizes.front() > 0;
+}
+
+// Batch mode (--h=...): one loaded graph serves every h in increasing order.
+// In exact mode the clique cache advances level by level, each level
+// extending the cliques of the one before, so nothing is listed twice.
+// Ends with a table of density, size and timing per h.
+void runCliqueSizeBatch(Graph& G, const vector<int>& sizes, const string& mode, MaxFlowSolver& solver,
+                        bool bisect, double gap, int passes) {
+    struct Row {
+        int h;
+        int vertices;
+        long long cliques;
+        double density;
+        long long enumerateMs;
+        long long searchMs;
+    };
+    vector<Row> rows;
+    
+    bool exact = mode == "exact";
+    if (exact) {
+        cout << "Using " << solver.name() << " max-flow engine" << endl;
+        G.startCliqueLevels();
     }
     
-    cout << "\nBinary search complete. Final density estimate: " << l << endl;
+    for (int h : sizes) {
+        cout << "\n=== " << h << "-clique densest subgraph ===" << endl;
+        auto start = chrono::high_resolution_clock::now();
+        
+        // The last requested level is only counted, never stored
+        if (exact) {
+            while (G.getCliqueLevel() < h) {
+                G.advanceCliqueLevel(G.getCliqueLevel() + 1 < sizes.back());
+            }
+            cout << "Clique chain at h=" << h << ": " << G.countCliques(h) << " " << h << "-cliques, "
+                 << G.getHMinus1Cliques(h).size() << " stored " << (h - 1) << "-cliques" << endl;
+        }
+        auto enumerated = chrono::high_resolution_clock::now();
+        
+        Graph D = mode == "peel" ? peelCliqueDenseSubgraph(G, h)
+                : mode == "iterative" ? iterateCliqueDenseSubgraph(G, h, gap, passes)
+                : findCliqueDenseSubgraph(G, h, solver, bisect);
+        auto searched = chrono::high_resolution_clock::now();
+        
+        Row row;
+        row.h = h;
+        row.vertices = D.getVertexCount();
+        {
+            UnmeteredSpan check;
+            row.cliques = D.countCliques(h);
+        }
+        row.density = row.vertices > 0 ? (double)row.cliques / row.vertices : 0;
+        row.enumerateMs = chrono::duration_cast<chrono::milliseconds>(enumerated - start).count();
+        row.searchMs = chrono::duration_cast<chrono::milliseconds>(searched - enumerated).count();
+        rows.push_back(row);
+    }
     
-    // Return the best subgraph found
-    if (!bestD.empty()) {
-        return G.getInducedSubgraph(bestD);
-    } else if (!D.empty()) {
-        return G.getInducedSubgraph(D);
-    } else {
-        // If no non-trivial subgraph found, return original graph
-        return G;
+    cout << "\n  h   vertices    h-cliques        density   cliques ms    search ms" << endl;
+    for (const Row& row : rows) {
+        char line[128];
+        snprintf(line, sizeof(line), "%3d %10d %12lld %14.4f %12lld %12lld",
+                 row.h, row.vertices, row.cliques, row.density, row.enumerateMs, row.searchMs);
+        cout << line << endl;
     }
 }
 
 int main(int argc, char** argv) {
     try {
         // Read input from file or stdin
-        unordered_map<int, int> mp;
-        ifstream inputFile;
         cout << "Reading input..." << endl;
         
-        string filename = argv[1];
-        inputFile.open(filename);
-        
-        if (!inputFile.is_open()) {
-            cout << "File not found, reading from stdin..." << endl;
-            
-            // Create a file from stdin
-            ofstream tempFile("temp_input.txt");
-            string line;
-            while (getline(cin, line)) {
-                tempFile << line << endl;
-            }
-            tempFile.close();
-            
-            inputFile.open("temp_input.txt");
-            if (!inputFile.is_open()) {
-                cerr << "Error creating temporary file!" << endl;
-                return 1;
+        // Positional argument: the edge-list file; options: --flow=<engine>,
+        // --cold-start, --cache-dir=<dir>, --no-cache, --threads=<n>, --simd=<kernels>,
+        // --mode=exact|peel|iterative, --search=dinkelbach|bisect,
+        // --gap=<relative gap>, --passes=<n>, --h=<first..last or list>,
+        // --quiet, --metrics=<json file>, --perf
+        string filename;
+        string metricsFile;
+        bool perf = false;
+        string cliqueSizes;
+        string mode = "exact";
+        string search = "dinkelbach";
+        double gap = 0.01;
+        int passes = 200;
+        string flowEngine = "dinic";
+        bool warmStart = true;
+        string cacheDir = ".cliquecache";
+        int threads = max(1u, thread::hardware_concurrency());
+        string simd = "auto";
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            if (arg.rfind("--flow=", 0) == 0) {
+                flowEngine = arg.substr(7);
+            } else if (arg == "--cold-start") {
+                warmStart = false;
+            } else if (arg.rfind("--cache-dir=", 0) == 0) {
+                cacheDir = arg.substr(12);
+            } else if (arg == "--no-cache") {
+                cacheDir.clear();
+            } else if (arg.rfind("--threads=", 0) == 0) {
+                threads = max(1, atoi(arg.c_str() + 10));
+            } else if (arg.rfind("--simd=", 0) == 0) {
+                simd = arg.substr(7);
+            } else if (arg.rfind("--mode=", 0) == 0) {
+                mode = arg.substr(7);
+            } else if (arg.rfind("--search=", 0) == 0) {
+                search = arg.substr(9);
+            } else if (arg.rfind("--h=", 0) == 0) {
+                cliqueSizes = arg.substr(4);
+            } else if (arg.rfind("--gap=", 0) == 0) {
+                gap = atof(arg.c_str() + 6);
+            } else if (arg.rfind("--passes=", 0) == 0) {
+                passes = max(1, atoi(arg.c_str() + 9));
+            } else if (arg == "--quiet") {
+                quietMode = true;
+            } else if (arg.rfind("--metrics=", 0) == 0) {
+                metricsFile = arg.substr(10);
+            } else if (arg == "--perf") {
+                perf = true;
+            } else {
+                filename = arg;
             }
         }
         
-        int n, m, h, waste;
-        cin>>h;
-        inputFile >> n >> m;
-        
-        // Input validation
-        if (n <= 0 || m < 0 || h <= 0) {
-            cerr << "Invalid input parameters: n=" << n << ", m=" << m << ", h=" << h << endl;
-            cerr << "Require: n > 0, m >= 0, h > 0" << endl;
+        unique_ptr<MaxFlowSolver> solver = makeMaxFlowSolver(flowEngine, warmStart);
+        if (!solver) {
+            cerr << "Unknown flow engine '" << flowEngine << "' (use dinic, push-relabel or push-relabel-flow)" << endl;
             return 1;
         }
-        
-        if (n > 1000000) {
-            cerr << "Graph too large! Maximum supported size is 1,000,000 vertices." << endl;
+        if (mode != "exact" && mode != "peel" && mode != "iterative") {
+            cerr << "Unknown mode '" << mode << "' (use exact, peel or iterative)" << endl;
+            return 1;
+        }
+        if (search != "dinkelbach" && search != "bisect") {
+            cerr << "Unknown search '" << search << "' (use dinkelbach or bisect)" << endl;
             return 1;
         }
+        if (!pickIntersectKernels(simd, intersectKernels)) {
+            cerr << "Intersection kernels '" << simd << "' are unknown or not supported by this CPU"
+                 << " (use auto, avx512, avx2, sse or scalar)" << endl;
+            return 1;
+        }
+        cout << "Using " << intersectKernels.name << " intersection kernels" << endl;
+        string perfProblem;
+        if (perf && !enablePerfCounters(perfProblem)) {
+            cout << "Hardware counters unavailable (" << perfProblem << "), continuing without --perf" << endl;
+        }
         
-        cout << "Creating graph with " << n << " vertices and " << m << " edges..." << endl;
-        Graph G(n);
-        
-        // Read edges with validation
-        int invalidEdges = 0;
-        int nodes = 0;
-        for (int i = 0; i < m; i++) {
-            int u, v;
-            if (!(inputFile >> u >> v >> waste)) {
-                cerr << "Error reading edge #" << i << endl;
-                break;
-            }
-            if(mp.find(u) != mp.end()) 
-                u = mp[u];
-            else
-                mp[u] = nodes++;
-            if(mp.find(v) != mp.end())
-                v = mp[v];
-            else
-                mp[v] = nodes++;
-            u = mp[u];
-            v = mp[v];
-            // Check if vertices are valid
-            if (u < 0 || u >= n || v < 0 || v >= n) {
-                invalidEdges++;
-                if (invalidEdges < 10) {
-                    cerr << "Warning: Invalid edge (" << u << ", " << v << ")" << endl;
-                }
-                continue;
+        // Without --h a single clique size is read from standard input
+        vector<int> batchSizes;
+        int h = 0;
+        if (!cliqueSizes.empty()) {
+            if (!parseCliqueSizes(cliqueSizes, batchSizes)) {
+                cerr << "Invalid clique sizes '" << cliqueSizes << "' (use a range like 2..8 or a list like 3,5,7)" << endl;
+                return 1;
+            }
+        } else {
+            cin >> h;
+            if (h <= 0) {
+                cerr << "Invalid clique size h=" << h << " (require h > 0)" << endl;
+                return 1;
             }
-            
-            G.addEdge(u, v);
-            
-            // Print progress indicator for large inputs
-           // if (m > 10000 && i % (m/100) == 0) {
-             //   cout << "\rReading edges: " << (i*100/m) << "% complete" << flush;
-            //}
         }
-        inputFile.close();
         
-        if (invalidEdges > 0) {
-            cerr << "Warning: " << invalidEdges << " invalid edges were ignored" << endl;
+        auto loadStart = chrono::high_resolution_clock::now();
+        
+        unique_ptr<Graph> loaded;
+        IntArray originalId;
+        if (!loadGraph(filename, threads, loaded, originalId)) {
+            return 1;
         }
+        Graph& G = *loaded;
+        G.setCliqueCacheDirectory(cacheDir);
+        G.setThreadCount(threads);
+        int n = G.getVertexCount();
+        
+        auto loadEnd = chrono::high_resolution_clock::now();
+        cout << "Loaded in " << chrono::duration_cast<chrono::milliseconds>(loadEnd - loadStart).count()
+             << "ms with " << threads << " thread(s)" << endl;
         
-        if (m > 10000) cout << "\rReading edges: 100% complete" << endl;
+        cout << "Original Graph has " << n << " vertices and " << G.getEdgeCount() << " edges." << endl;
         
-        cout << "Original Graph has " << n << " vertices and " << m << " edges." << endl;
+        if (!batchSizes.empty()) {
+            runCliqueSizeBatch(G, batchSizes, mode, *solver, search == "bisect", gap, passes);
+            if (perfEnabled) printPerfTotals();
+            double loadMs = chrono::duration<double, milli>(loadEnd - loadStart).count();
+            double totalMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - loadStart).count();
+            if (!metricsFile.empty() && !writeMetrics(metricsFile, loadMs, totalMs)) {
+                cerr << "Could not write metrics to " << metricsFile << endl;
+            }
+            return 0;
+        }
         
         // For very large graphs, limit h
        // if (n > 10000 && h > 3) {
@@ -717,18 +2116,37 @@ int main(int argc, char** argv) {
         auto startTime = chrono::high_resolution_clock::now();
         
         // Find the clique-dense subgraph
-        Graph D = findCliqueDenseSubgraph(G, h);
+        if (mode == "exact") {
+            cout << "Using " << solver->name() << " max-flow engine" << endl;
+        }
+        Graph D = mode == "peel" ? peelCliqueDenseSubgraph(G, h)
+                : mode == "iterative" ? iterateCliqueDenseSubgraph(G, h, gap, passes)
+                : findCliqueDenseSubgraph(G, h, *solver, search == "bisect");
         
         // End time tracking
         auto endTime = chrono::high_resolution_clock::now();
-        auto duration = chrono::duration_cast<chrono::seconds>(endTime - startTime).count();
+        double duration = chrono::duration<double>(endTime - startTime).count();
+        
+        cout << "\nCompleted in " << fixed << setprecision(3) << duration << " seconds!" << endl;
         
-        cout << "\nCompleted in " << duration << " seconds!" << endl;
+        // One machine-readable line per run, read by Benchmark/benchmark.cpp
+        double loadMs = chrono::duration<double, milli>(loadEnd - loadStart).count();
+        cout << "Timings (ms): load " << loadMs << ", cliques " << metrics.cliques / 1000.0
+             << ", network " << metrics.network / 1000.0 << ", flow " << metrics.flow / 1000.0
+             << ", total " << loadMs + duration * 1000 << endl;
+        if (perfEnabled) printPerfTotals();
+        
+        // Written before the result is checked below, so the JSON matches
+        // the Timings line and excludes the recount
+        if (!metricsFile.empty() && !writeMetrics(metricsFile, loadMs, loadMs + duration * 1000)) {
+            cerr << "Could not write metrics to " << metricsFile << endl;
+        }
         cout << "Clique-Dense Subgraph found with " << D.getVertexCount() << " vertices!" << endl;
         
         if (D.getVertexCount() < 10000) {
-            cout << "Number of " << h << "-cliques in CDS: " << D.countCliques(h) << endl;
-            cout << h << "-clique density of CDS: " << D.cliqueDensity(h) << endl;
+            long long cliqueCount = D.countCliques(h);
+            cout << "Number of " << h << "-cliques in CDS: " << cliqueCount << endl;
+            cout << h << "-clique density of CDS: " << setprecision(6) << D.cliqueDensity(h) << endl;
         } else {
             cout << "Subgraph is large, skipping detailed clique analysis to save memory." << endl;
         }
@@ -1,115 +1,621 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <queue>
 #include <algorithm>
-#include <unordered_set>
 #include <unordered_map>
 #include <limits>
 #include <iomanip>
+#include <sstream>
 #include <chrono>
 #include <cmath>
 #include <set>
-#include <functional>
+#include <memory>
+#include <string>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <numeric>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../Common/intersect.h"
+#include "../Common/snapshot.h"
+#include "../Common/clique_cache.h"
+#include "../Common/perf_counters.h"
+#include "../Common/parallel.h"
+#include "../Common/edge_list.h"
+#include "../Common/metrics.h"
+#include "../Common/max_flow.h"
 
 using namespace std;
 
+// Read-only slice of one sorted adjacency row
+struct AdjacencySlice {
+    const int* head;
+    const int* tail;
+
+    const int* begin() const { return head; }
+    const int* end() const { return tail; }
+    int size() const { return static_cast<int>(tail - head); }
+    bool includes(int v) const { return binary_search(head, tail, v); }
+};
+
+// Arena of equal-width cliques: clique i lives at cells[i*stride, (i+1)*stride)
+// in a single buffer, with an optional CSR index from vertex to clique ids
+class CliqueArena {
+private:
+    int stride = 0;
+    IntArray cells;
+    vector<size_t> memberStart; // clique ids of v are memberOf[memberStart[v] .. memberStart[v+1])
+    vector<int> memberOf;
+
+public:
+    // View over a contiguous run of ints inside the arena
+    struct Row {
+        const int* head;
+        const int* tail;
+
+        const int* begin() const { return head; }
+        const int* end() const { return tail; }
+        int size() const { return static_cast<int>(tail - head); }
+        int operator[](int i) const { return head[i]; }
+    };
+
+    class Cursor {
+    private:
+        const int* at;
+        int step;
+
+    public:
+        Cursor(const int* p, int w) : at(p), step(w) {}
+        Row operator*() const { return {at, at + step}; }
+        Cursor& operator++() { at += step; return *this; }
+        bool operator!=(const Cursor& other) const { return at != other.at; }
+    };
+
+    void clearWithStride(int width) {
+        stride = width;
+        cells = IntArray();
+        vector<size_t>().swap(memberStart);
+        vector<int>().swap(memberOf);
+    }
+
+    void record(const int* clique) { cells.append(clique, stride); }
+
+    // Serve cliques straight out of a mapped cache file
+    void lendFrom(shared_ptr<const MappedFile> file, const int* values, size_t total, int width) {
+        clearWithStride(width);
+        cells.borrow(move(file), values, total);
+    }
+
+    // Take over cliques already stored back to back
+    void takeCells(vector<int>&& values) { cells.adopt(move(values)); }
+
+    const IntArray& storage() const { return cells; }
+
+    int width() const { return stride; }
+    size_t size() const { return stride == 0 ? 0 : cells.size() / stride; }
+    bool empty() const { return cells.size() == 0; }
+
+    Row operator[](size_t i) const {
+        const int* p = cells.data() + i * stride;
+        return {p, p + stride};
+    }
+
+    Cursor begin() const { return Cursor(cells.data(), stride); }
+    Cursor end() const { return Cursor(cells.data() + cells.size(), stride); }
+
+    void indexMembers(int vertexTotal) {
+        memberStart.assign(vertexTotal + 1, 0);
+        for (int v : cells) {
+            memberStart[v + 1]++;
+        }
+        int v = 0;
+        while (v < vertexTotal) {
+            memberStart[v + 1] += memberStart[v];
+            v++;
+        }
+        vector<size_t> place(memberStart.begin(), memberStart.end() - 1);
+        memberOf.resize(cells.size());
+        size_t i = 0;
+        while (i < cells.size()) {
+            memberOf[place[cells[i]]++] = i / stride;
+            i++;
+        }
+    }
+
+    // Clique ids containing v; empty before indexMembers()
+    Row containing(int v) const {
+        if (memberStart.empty()) return {nullptr, nullptr};
+        return {memberOf.data() + memberStart[v], memberOf.data() + memberStart[v + 1]};
+    }
+};
+
 // Structure representing a graph for 
 class GraphStructure {
 private:
     int vertexCount; // Total vertices
-    vector<unordered_set<int>> adjacencyList; // Adjacency list for edge storage
-    mutable vector<vector<int>> cliqueCacheH; // Cache for h-cliques
-    mutable vector<vector<int>> cliqueCacheHMinus1; // Cache for (h-1)-cliques
-    mutable vector<vector<int>> vertexCliqueMapping; // Maps vertices to cliques
+    vector<pair<int, int>> stagedEdges; // Edges inserted since the last compaction
+    IntArray rowStart;  // CSR offsets into adjacencyArray, vertexCount + 1 entries
+    IntArray adjacencyArray; // Sorted, duplicate-free adjacency rows back to back
+    IntArray forwardStart; // CSR offsets of the degeneracy-oriented DAG
+    IntArray forwardArray; // Forward neighbours (peeled later), sorted by id
+    int degeneracyBound = 0;  // Maximum forward degree
+    mutable vector<long long> cliqueDegreeH; // h-cliques through each vertex
+    mutable long long cliqueTotalH = 0; // Total h-cliques
+    mutable CliqueArena cliqueCacheHMinus1; // Cache for (h-1)-cliques
     mutable bool isCacheReady = false;
+    string persistDirectory; // Where clique indexes are kept between runs; empty = never
 
-    // Check if vertex is connected to all in the given set
-    bool hasConnectionsToAll(int vertex, const vector<int>& group) const {
-        if (vertex < 0 || vertex >= vertexCount) return false;
-        int idx = 0;
-        while (idx < group.size()) {
-            int u = group[idx];
-            if (u < 0 || u >= vertexCount || adjacencyList[vertex].count(u) == 0) {
-                return false;
-            }
-            idx++;
-        }
+    // Graph and h identifying a persisted clique index (Common/clique_cache.h)
+    CliqueCacheKey persistedCacheKey(int h) const {
+        return {contentFingerprint(), vertexCount, (int64_t)adjacencyArray.size(), h};
+    }
+
+    string persistedCachePath(int h) const {
+        return cliqueCacheFileName(persistDirectory, persistedCacheKey(h));
+    }
+
+    // Adopt a persisted clique index for h; the cliques stay in the mapping
+    bool restoreCliqueCache(const string& path, int h) const {
+        shared_ptr<MappedFile> file;
+        CliqueCacheView persisted;
+        if (!mapCliqueCacheFile(path, persistedCacheKey(h), file, persisted)) return false;
+
+        cliqueDegreeH.resize(vertexCount);
+        memcpy(cliqueDegreeH.data(), persisted.degrees, sizeof(int64_t) * vertexCount);
+        cliqueTotalH = persisted.hCliqueTotal;
+        cliqueCacheHMinus1.lendFrom(file, persisted.cliques, (size_t)persisted.storedCliques * (h - 1), h - 1);
         return true;
     }
 
-    // Iterative triangle detection for h=3
-    void detectTriangles(vector<vector<int>>& resultCliques) const {
-        resultCliques.clear();
-        cout << "Detecting triangles efficiently... " << flush;
-        int triangleCount = 0;
+    // Store the clique index; written to a temporary name and renamed
+    bool persistCliqueCache(const string& path, int h) const {
+        mkdir(persistDirectory.c_str(), 0755);
+        return writeCliqueCacheFile(path, persistedCacheKey(h), cliqueTotalH, cliqueDegreeH.data(),
+                                    cliqueCacheHMinus1.storage().data(), cliqueCacheHMinus1.size());
+    }
 
-        int u = 0;
-        while (u < vertexCount) {
-            for (int v : adjacencyList[u]) {
-                if (v <= u) continue;
-                for (int w : adjacencyList[u]) {
-                    if (w <= v) continue;
-                    if (adjacencyList[v].count(w)) {
-                        resultCliques.push_back({u, v, w});
-                        triangleCount++;
-                        if (triangleCount % 10000 == 0) {
-                            cout << "*" << flush;
-                        }
-                    }
+    int workerCount = 1; // Threads for clique enumeration and tallies
+
+    // Give every frontier level room for `capacity` ids plus INTERSECT_PADDING
+    static void sizeFrontier(vector<vector<int>>& frontier, int levels, int capacity) {
+        if ((int)frontier.size() < levels) frontier.resize(levels);
+        for (auto& level : frontier) {
+            if ((int)level.size() < capacity + INTERSECT_PADDING) level.resize(capacity + INTERSECT_PADDING);
+        }
+    }
+
+    // Bit-matrix copy of a small candidate pool: bit j of row i is set when
+    // pool member j is a forward neighbour of pool member i. Bits keep pool
+    // order (ascending id), so cliques come out in the same order as from
+    // expandClique.
+    struct BitNeighbourhood {
+        vector<int> position;      // vertex -> index in the pool, or -1
+        vector<int> members;       // index in the pool -> vertex
+        vector<uint64_t> bitRows;
+        vector<uint64_t> depthBits; // candidate set of every depth
+        int wordCount = 0;
+    };
+
+    // Pools up to this size (four words) are enumerated as bitsets
+    static const int BIT_NEIGHBOURHOOD_CAP = 256;
+
+    // Enumeration state owned by one thread
+    struct EnumerationState {
+        vector<int> members;
+        vector<vector<int>> frontier;
+        BitNeighbourhood bits;
+
+        void ready(int h, int capacity) {
+            members.assign(h, 0);
+            sizeFrontier(frontier, h, capacity);
+        }
+    };
+
+    // Number of roots in one unit of parallel work
+    static const int ROOT_BATCH = 64;
+
+    // With h >= 4, a root with this many forward neighbours or more is cut
+    // into tasks of BRANCHES_PER_TASK depth-1 branches
+    static const int SPLIT_FORWARD_DEGREE = 16;
+    static const int BRANCHES_PER_TASK = 4;
+
+    // Roots rootBegin .. rootEnd - 1, or, when branchEnd >= 0, only the
+    // branches branchBegin .. branchEnd - 1 of the single root rootBegin
+    struct EnumerationTask {
+        int rootBegin = 0, rootEnd = 0;
+        int branchBegin = 0, branchEnd = -1;
+
+        // Sort key that restores the serial enumeration order
+        long long sequence() const { return (long long)rootBegin << 32 | (branchEnd < 0 ? 0 : branchBegin); }
+    };
+
+    // Enumerate cliques on the work-stealing pool; visitorFor(task, worker)
+    // supplies the visitor of one task. Root batches are dealt to workers
+    // in contiguous blocks. A batch reaching a heavy root enqueues the root's
+    // branches and the remainder of the batch, so idle workers can steal them.
+    template <class VisitorFor>
+    void enumerateOnPool(int h, VisitorFor visitorFor) const {
+        int batches = (vertexCount + ROOT_BATCH - 1) / ROOT_BATCH;
+        StealingPool<EnumerationTask> pool(max(1, min(workerCount, batches)));
+        int lanes = pool.workerCount();
+        int batch = 0;
+        while (batch < batches) {
+            EnumerationTask task;
+            task.rootBegin = batch * ROOT_BATCH;
+            task.rootEnd = min(vertexCount, (batch + 1) * ROOT_BATCH);
+            pool.push((long long)batch * lanes / batches, task);
+            batch++;
+        }
+
+        vector<EnumerationState> states(lanes);
+        pool.run([&](const EnumerationTask& task, int worker) {
+            EnumerationState& state = states[worker];
+            if (state.members.empty()) state.ready(h, degeneracyBound);
+            auto visit = visitorFor(task, worker);
+            if (task.branchEnd >= 0) {
+                visitCliquesAtRoot(task.rootBegin, task.branchBegin, task.branchEnd, h, state, visit);
+                return;
+            }
+
+            int u = task.rootBegin;
+            while (u < task.rootEnd) {
+                int forwardDegree = forwardStart[u + 1] - forwardStart[u];
+                if (h < 4 || forwardDegree < SPLIT_FORWARD_DEGREE) {
+                    visitCliquesAtRoot(u, 0, forwardDegree, h, state, visit);
+                    u++;
+                    continue;
                 }
+
+                // Remainder first: this worker pops from the back, so it
+                // continues with the branches of u
+                if (u + 1 < task.rootEnd) {
+                    EnumerationTask remainder;
+                    remainder.rootBegin = u + 1;
+                    remainder.rootEnd = task.rootEnd;
+                    pool.push(worker, remainder);
+                }
+                int branch = 0;
+                while (branch < forwardDegree) {
+                    EnumerationTask piece;
+                    piece.rootBegin = u;
+                    piece.rootEnd = u + 1;
+                    piece.branchBegin = branch;
+                    piece.branchEnd = min(forwardDegree, branch + BRANCHES_PER_TASK);
+                    pool.push(worker, piece);
+                    branch += BRANCHES_PER_TASK;
+                }
+                return;
             }
+        }, meterWorkers());
+        progressOutput() << " (" << pool.summary() << ") " << flush;
+    }
+
+    // Visit the h-cliques whose first vertex in degeneracy order is one of
+    // the roots first .. last - 1, in increasing root order
+    template <class Visitor>
+    void visitCliquesRootedIn(int first, int last, int h, EnumerationState& state, Visitor& visit) const {
+        int u = first;
+        while (u < last) {
+            visitCliquesAtRoot(u, 0, forwardStart[u + 1] - forwardStart[u], h, state, visit);
             u++;
         }
-        cout << " Identified " << resultCliques.size() << " triangles." << endl;
     }
 
-    // Iterative clique detection for small h values
-    void detectCliques(int h, vector<vector<int>>& resultCliques) const {
-        resultCliques.clear();
-        if (h == 3) {
-            detectTriangles(resultCliques);
+    // Visit the h-cliques rooted at u whose second member is forward
+    // neighbour branchBegin .. branchEnd - 1 of u
+    template <class Visitor>
+    void visitCliquesAtRoot(int u, int branchBegin, int branchEnd, int h, EnumerationState& state, Visitor& visit) const {
+        state.members[0] = u;
+        if (h == 1) {
+            visit(state.members.data());
             return;
         }
+        AdjacencySlice forward = forwardOf(u);
+        if (forward.size() < h - 1) return;
+        if (h >= 3 && forward.size() <= BIT_NEIGHBOURHOOD_CAP) {
+            loadBitNeighbourhood(forward.begin(), forward.size(), h, state.bits);
+            expandBitClique(1, h, state.members, state.bits, visit, branchBegin, branchEnd);
+        } else {
+            expandClique(1, h, state.members, state.frontier, forward.begin(), forward.size(), visit, branchBegin, branchEnd);
+        }
+    }
+
+    // Copy pool[0..poolSize) into bits; depth 1 starts with the whole pool
+    void loadBitNeighbourhood(const int* pool, int poolSize, int h, BitNeighbourhood& bits) const {
+        if ((int)bits.position.size() < vertexCount) bits.position.assign(vertexCount, -1);
+        int words = (poolSize + 63) / 64;
+        bits.wordCount = words;
+        bits.members.assign(pool, pool + poolSize);
+        bits.bitRows.assign((size_t)poolSize * words, 0);
+        bits.depthBits.assign((size_t)h * words, 0);
+
+        int i = 0;
+        while (i < poolSize) {
+            bits.position[pool[i]] = i;
+            i++;
+        }
+        i = 0;
+        while (i < poolSize) {
+            uint64_t* row = &bits.bitRows[(size_t)i * words];
+            for (int w : forwardOf(pool[i])) {
+                int j = bits.position[w];
+                if (j >= 0) row[j >> 6] |= uint64_t(1) << (j & 63);
+            }
+            i++;
+        }
+        i = 0;
+        while (i < poolSize) {
+            bits.position[pool[i]] = -1;
+            bits.depthBits[words + (i >> 6)] |= uint64_t(1) << (i & 63);
+            i++;
+        }
+    }
 
-        cout << " Searching for " << h << "-cliques with iterative backtracking... " << flush;
-        const size_t CLIQUE_LIMIT = 1000000;
-        size_t iterationLimit = 100000000;
-        size_t currentIteration = 0;
+    // The bits branchBegin .. branchEnd - 1 that fall in word `word`
+    static uint64_t branchMask(int word, int branchBegin, int branchEnd) {
+        int low = max(branchBegin - 64 * word, 0);
+        int high = min(branchEnd - 64 * word, 64);
+        if (low >= high) return 0;
+        uint64_t below = high == 64 ? ~uint64_t(0) : (uint64_t(1) << high) - 1;
+        return below & ~((uint64_t(1) << low) - 1);
+    }
 
-        function<void(vector<int>&, int)> exploreCliques = [&](vector<int>& currentClique, int startVertex) {
-            currentIteration++;
-            if (currentIteration % 100000 == 0) {
-                cout << "*" << flush;
-                if (currentIteration % 5000000 == 0) {
-                    cout << " [Iteration " << currentIteration << ", " << resultCliques.size() << " cliques]" << endl;
+    // expandClique on a BitNeighbourhood: narrowing the pool is an AND with
+    // one bit row, and the graph arrays are not read again. Only pool bits
+    // branchBegin .. branchEnd - 1 are branched on at this depth.
+    template <class Visitor>
+    void expandBitClique(int depth, int h, vector<int>& members, BitNeighbourhood& bits, Visitor& visit,
+                         int branchBegin = 0, int branchEnd = numeric_limits<int>::max()) const {
+        int words = bits.wordCount;
+        const uint64_t* pool = &bits.depthBits[(size_t)depth * words];
+        int word = 0;
+        if (depth == h - 1) {
+            while (word < words) {
+                uint64_t rest = pool[word] & branchMask(word, branchBegin, branchEnd);
+                while (rest) {
+                    members[depth] = bits.members[word * 64 + __builtin_ctzll(rest)];
+                    visit(members.data());
+                    rest &= rest - 1;
                 }
+                word++;
             }
+            return;
+        }
 
-            if (resultCliques.size() >= CLIQUE_LIMIT || currentIteration >= iterationLimit) {
-                return;
+        uint64_t* narrowed = &bits.depthBits[(size_t)(depth + 1) * words];
+        int stillNeeded = h - depth - 1;
+        while (word < words) {
+            uint64_t rest = pool[word] & branchMask(word, branchBegin, branchEnd);
+            while (rest) {
+                int i = word * 64 + __builtin_ctzll(rest);
+                rest &= rest - 1;
+                const uint64_t* row = &bits.bitRows[(size_t)i * words];
+                int kept = 0;
+                int x = 0;
+                while (x < words) {
+                    narrowed[x] = pool[x] & row[x];
+                    kept += popCount64(narrowed[x]);
+                    x++;
+                }
+                if (kept < stillNeeded) continue;
+                members[depth] = bits.members[i];
+                expandBitClique(depth + 1, h, members, bits, visit);
             }
+            word++;
+        }
+    }
 
-            if (currentClique.size() == h) {
-                resultCliques.push_back(currentClique);
-                return;
+    // Cliques expandBitClique would visit; the last level is a popcount
+    long long countBitExpansions(int depth, int h, BitNeighbourhood& bits) const {
+        int words = bits.wordCount;
+        const uint64_t* pool = &bits.depthBits[(size_t)depth * words];
+        long long found = 0;
+        int word = 0;
+        if (depth == h - 1) {
+            while (word < words) found += popCount64(pool[word++]);
+            return found;
+        }
+
+        uint64_t* narrowed = &bits.depthBits[(size_t)(depth + 1) * words];
+        int stillNeeded = h - depth - 1;
+        while (word < words) {
+            uint64_t rest = pool[word];
+            while (rest) {
+                const uint64_t* row = &bits.bitRows[(size_t)(word * 64 + __builtin_ctzll(rest)) * words];
+                rest &= rest - 1;
+                int kept = 0;
+                int x = 0;
+                while (x < words) {
+                    narrowed[x] = pool[x] & row[x];
+                    kept += popCount64(narrowed[x]);
+                    x++;
+                }
+                if (depth == h - 2) {
+                    found += kept;
+                } else if (kept >= stillNeeded) {
+                    found += countBitExpansions(depth + 1, h, bits);
+                }
             }
+            word++;
+        }
+        return found;
+    }
+
+    // One level of the k-clique enumeration. pool[0..poolSize) lists, sorted
+    // by id, the vertices that are forward neighbours of every member so far;
+    // the next level is built in frontier[depth + 1]. Only pool entries
+    // branchBegin .. branchEnd - 1 are branched on at this depth.
+    template <class Visitor>
+    void expandClique(int depth, int h, vector<int>& members, vector<vector<int>>& frontier,
+                      const int* pool, int poolSize, Visitor& visit,
+                      int branchBegin = 0, int branchEnd = numeric_limits<int>::max()) const {
+        int i = branchBegin;
+        int stop = min(poolSize, branchEnd);
+        if (depth == h - 1) {
+            while (i < stop) {
+                members[depth] = pool[i++];
+                visit(members.data());
+            }
+            return;
+        }
+
+        int* narrowed = frontier[depth + 1].data();
+        int stillNeeded = h - depth - 1;
+        while (i < stop) {
+            int v = pool[i++];
+            AdjacencySlice forward = forwardOf(v);
+            if (forward.size() < stillNeeded) continue;
+            int kept = intersectInto(pool, poolSize, forward.begin(), forward.size(), narrowed);
+            if (kept < stillNeeded) continue;
+            members[depth] = v;
+            expandClique(depth + 1, h, members, frontier, narrowed, kept, visit);
+        }
+    }
 
-            int i = startVertex;
-            while (i < vertexCount && resultCliques.size() < CLIQUE_LIMIT) {
-                if (hasConnectionsToAll(i, currentClique)) {
-                    currentClique.push_back(i);
-                    exploreCliques(currentClique, i + 1);
-                    currentClique.pop_back();
+    // How many cliques expandClique would visit from this state; the last
+    // level is counted with intersectCount instead of being built
+    long long countExpansions(int depth, int h, vector<vector<int>>& frontier, const int* pool, int poolSize) const {
+        if (depth == h - 1) return poolSize;
+        int stillNeeded = h - depth - 1;
+        long long found = 0;
+        int i = 0;
+        while (i < poolSize) {
+            AdjacencySlice forward = forwardOf(pool[i++]);
+            if (forward.size() < stillNeeded) continue;
+            if (depth == h - 2) {
+                found += intersectCount(pool, poolSize, forward.begin(), forward.size());
+            } else {
+                int* narrowed = frontier[depth + 1].data();
+                int kept = intersectInto(pool, poolSize, forward.begin(), forward.size(), narrowed);
+                if (kept >= stillNeeded) found += countExpansions(depth + 1, h, frontier, narrowed, kept);
+            }
+        }
+        return found;
+    }
+
+    // Enumerate every h-clique into resultCliques
+    void detectCliques(int h, CliqueArena& resultCliques) const {
+        resultCliques.clearWithStride(h);
+        progressOutput() << " Enumerating " << h << "-cliques over the degeneracy DAG... " << flush;
+
+        if (workerCount <= 1 || h <= 0) {
+            visitCliques(h, [&](const int* members) {
+                resultCliques.record(members);
+                if (resultCliques.size() % 100000 == 0) {
+                    progressOutput() << "*" << flush;
                 }
-                i++;
+            });
+        } else {
+            // Per-task buffers joined in task sequence give the serial order
+            vector<vector<pair<long long, vector<int>>>> laneCells(workerCount);
+            enumerateOnPool(h, [&](const EnumerationTask& task, int worker) {
+                laneCells[worker].emplace_back(task.sequence(), vector<int>());
+                vector<int>* found = &laneCells[worker].back().second;
+                return [found, h](const int* members) { found->insert(found->end(), members, members + h); };
+            });
+
+            vector<pair<long long, vector<int>>> taskCells;
+            for (auto& lane : laneCells) {
+                for (auto& cells : lane) taskCells.push_back(move(cells));
             }
-        };
+            sort(taskCells.begin(), taskCells.end(),
+                 [](const pair<long long, vector<int>>& a, const pair<long long, vector<int>>& b) { return a.first < b.first; });
+
+            size_t total = 0;
+            for (const auto& cells : taskCells) total += cells.second.size();
+            vector<int> joined;
+            joined.reserve(total);
+            for (auto& cells : taskCells) {
+                joined.insert(joined.end(), cells.second.begin(), cells.second.end());
+                vector<int>().swap(cells.second);
+            }
+            resultCliques.takeCells(move(joined));
+        }
 
-        vector<int> currentClique;
-        exploreCliques(currentClique, 0);
-        cout << " Located " << resultCliques.size() << " cliques"
-             << (resultCliques.size() >= CLIQUE_LIMIT ? " (limit hit)" : "") << "." << endl;
+        progressOutput() << " Located " << resultCliques.size() << " cliques." << endl;
+    }
+
+    // Matula-Beck smallest-last ordering with a bucket queue; each edge is
+    // then directed towards the vertex peeled later, bounding out-degree by
+    // the graph degeneracy.
+    void orientByDegeneracy() {
+        int topDegree = 0;
+        int u = 0;
+        while (u < vertexCount) {
+            topDegree = max(topDegree, vertexDegree(u));
+            u++;
+        }
+
+        vector<int> liveDegree(vertexCount), bucketHead(topDegree + 2, 0), slotOf(vertexCount), peelSequence(vertexCount);
+        u = 0;
+        while (u < vertexCount) {
+            liveDegree[u] = vertexDegree(u);
+            bucketHead[liveDegree[u] + 1]++;
+            u++;
+        }
+        int d = 0;
+        while (d <= topDegree) {
+            bucketHead[d + 1] += bucketHead[d];
+            d++;
+        }
+        vector<int> nextSlot(bucketHead.begin(), bucketHead.end() - 1);
+        u = 0;
+        while (u < vertexCount) {
+            slotOf[u] = nextSlot[liveDegree[u]]++;
+            peelSequence[slotOf[u]] = u;
+            u++;
+        }
+
+        degeneracyBound = 0;
+        int i = 0;
+        while (i < vertexCount) {
+            u = peelSequence[i];
+            degeneracyBound = max(degeneracyBound, liveDegree[u]);
+            for (int v : adjacentTo(u)) {
+                if (slotOf[v] <= i || liveDegree[v] <= liveDegree[u]) continue;
+                int bucket = liveDegree[v];
+                int front = max(bucketHead[bucket], i + 1);
+                int w = peelSequence[front];
+                swap(peelSequence[front], peelSequence[slotOf[v]]);
+                swap(slotOf[w], slotOf[v]);
+                bucketHead[bucket] = front + 1;
+                liveDegree[v]--;
+            }
+            i++;
+        }
+
+        vector<int> dagStart(vertexCount + 1, 0);
+        u = 0;
+        while (u < vertexCount) {
+            int later = 0;
+            for (int v : adjacentTo(u)) {
+                if (slotOf[v] > slotOf[u]) later++;
+            }
+            dagStart[u + 1] = dagStart[u] + later;
+            u++;
+        }
+        vector<int> dagArray(dagStart[vertexCount]);
+        u = 0;
+        while (u < vertexCount) {
+            int k = dagStart[u];
+            for (int v : adjacentTo(u)) {
+                if (slotOf[v] > slotOf[u]) dagArray[k++] = v;
+            }
+            u++;
+        }
+        forwardStart.adopt(move(dagStart));
+        forwardArray.adopt(move(dagArray));
     }
 
 public:
@@ -118,93 +624,444 @@ public:
             vertexCount = 0;
             cerr << "Warning: Invalid graph size detected. Initializing empty graph." << endl;
         }
-        adjacencyList.resize(vertexCount);
+        rowStart.adopt(vector<int>(vertexCount + 1, 0));
     }
 
     void insertEdge(int u, int v) {
-        if (u < 0 || u >= vertexCount || v < 0 || v >= vertexCount) return;
-        adjacencyList[u].insert(v);
-        adjacencyList[v].insert(u);
+        if (u < 0 || u >= vertexCount || v < 0 || v >= vertexCount || u == v) return;
+        stagedEdges.push_back({u, v});
+    }
+
+    // Replace the staged edges with a complete list (endpoints already in
+    // range, no self-loops) and build the CSR rows from it
+    void adoptEdges(vector<pair<int, int>>&& edges) {
+        stagedEdges = move(edges);
+        compactAdjacency();
+    }
+
+    // Compact staged edges into the sorted CSR rows. Call after loading and
+    // before any query; parallel edges collapse into one.
+    void compactAdjacency() {
+        int u = 0;
+        while (u < vertexCount) {
+            int i = rowStart[u];
+            while (i < rowStart[u + 1]) {
+                if (u < adjacencyArray[i]) stagedEdges.push_back({u, adjacencyArray[i]});
+                i++;
+            }
+            u++;
+        }
+
+        vector<int> rowSize(vertexCount, 0);
+        for (const auto& edge : stagedEdges) {
+            rowSize[edge.first]++;
+            rowSize[edge.second]++;
+        }
+        vector<int> offsets(vertexCount + 1, 0);
+        u = 0;
+        while (u < vertexCount) {
+            offsets[u + 1] = offsets[u] + rowSize[u];
+            u++;
+        }
+
+        vector<int> slot(offsets.begin(), offsets.end() - 1);
+        vector<int> entries(offsets[vertexCount], 0);
+        for (const auto& edge : stagedEdges) {
+            entries[slot[edge.first]++] = edge.second;
+            entries[slot[edge.second]++] = edge.first;
+        }
+        vector<pair<int, int>>().swap(stagedEdges);
+
+        int kept = 0;
+        u = 0;
+        while (u < vertexCount) {
+            int from = offsets[u], to = offsets[u + 1];
+            sort(entries.begin() + from, entries.begin() + to);
+            offsets[u] = kept;
+            int i = from;
+            while (i < to) {
+                if (i == from || entries[i] != entries[i - 1]) {
+                    entries[kept++] = entries[i];
+                }
+                i++;
+            }
+            u++;
+        }
+        offsets[vertexCount] = kept;
+        entries.resize(kept);
+        entries.shrink_to_fit();
+        rowStart.adopt(move(offsets));
+        adjacencyArray.adopt(move(entries));
+
+        orientByDegeneracy();
+    }
+
+    // Point the CSR rows and the DAG at arrays inside a mapped snapshot;
+    // nothing is copied and the mapping stays open while it is referenced
+    void attachSnapshot(shared_ptr<const MappedFile> file, const int* offsets, const int* entries,
+                        const int* dagStart, const int* dagArray, int degeneracy) {
+        rowStart.borrow(file, offsets, vertexCount + 1);
+        adjacencyArray.borrow(file, entries, offsets[vertexCount]);
+        forwardStart.borrow(file, dagStart, vertexCount + 1);
+        forwardArray.borrow(file, dagArray, dagStart[vertexCount]);
+        degeneracyBound = degeneracy;
+        vector<pair<int, int>>().swap(stagedEdges);
+        isCacheReady = false;
+    }
+
+    const IntArray& rowOffsets() const { return rowStart; }
+    const IntArray& rowEntries() const { return adjacencyArray; }
+    const IntArray& forwardOffsets() const { return forwardStart; }
+    const IntArray& forwardEntries() const { return forwardArray; }
+    int getDegeneracyBound() const { return degeneracyBound; }
+
+    // Threads used to enumerate and tally cliques; 1 keeps it serial
+    void useWorkers(int workers) { workerCount = max(1, workers); }
+
+    // Directory for clique indexes reused across runs; "" turns this off
+    void usePersistDirectory(const string& directory) { persistDirectory = directory; }
+
+    // Hash of the vertex count and CSR rows; equal graphs hash equally
+    uint64_t contentFingerprint() const {
+        return graphFingerprint(vertexCount, rowStart, adjacencyArray);
     }
 
     int getTotalVertices() const { return vertexCount; }
 
+    long long getTotalEdges() const { return static_cast<long long>(adjacencyArray.size()) / 2; }
+
+    AdjacencySlice adjacentTo(int u) const {
+        return {adjacencyArray.data() + rowStart[u], adjacencyArray.data() + rowStart[u + 1]};
+    }
+
+    int vertexDegree(int u) const { return rowStart[u + 1] - rowStart[u]; }
+
+    // Vertices adjacent to all of group[0..count), sorted; intersection starts
+    // from the lowest-degree member's row
+    void sharedNeighbours(const int* group, int count, vector<int>& shared, vector<int>& buffer) const {
+        shared.clear();
+        if (count == 0) return;
+        int pivot = 0;
+        int i = 1;
+        while (i < count) {
+            if (vertexDegree(group[i]) < vertexDegree(group[pivot])) pivot = i;
+            i++;
+        }
+        AdjacencySlice row = adjacentTo(group[pivot]);
+        shared.assign(row.begin(), row.end());
+        int kept = shared.size();
+        i = 0;
+        while (i < count && kept > 0) {
+            if (i != pivot) {
+                AdjacencySlice other = adjacentTo(group[i]);
+                buffer.resize(kept + INTERSECT_PADDING);
+                kept = intersectInto(shared.data(), kept, other.begin(), other.size(), buffer.data());
+                shared.swap(buffer);
+            }
+            i++;
+        }
+        shared.resize(kept);
+    }
+
+    AdjacencySlice forwardOf(int u) const {
+        return {forwardArray.data() + forwardStart[u], forwardArray.data() + forwardStart[u + 1]};
+    }
+
+    // Invoke visit(const int* members) once per h-clique. Each clique is
+    // reached only from its first vertex in degeneracy order (kClist).
+    // Serial; detectCliques and tallyCliques parallelise the same walk.
+    template <class Visitor>
+    void visitCliques(int h, Visitor&& visit) const {
+        if (h <= 0) return;
+        EnumerationState state;
+        state.ready(h, degeneracyBound);
+        visitCliquesRootedIn(0, vertexCount, h, state, visit);
+    }
+
+    // Binary search in the shorter of the two rows
     bool edgeExists(int u, int v) const {
         if (u < 0 || u >= vertexCount || v < 0 || v >= vertexCount) return false;
-        return adjacencyList[u].count(v) > 0;
+        if (vertexDegree(u) > vertexDegree(v)) swap(u, v);
+        return adjacentTo(u).includes(v);
+    }
+
+    // Count h-cliques into per-vertex tallies without materializing any of
+    // them, so memory stays O(vertexCount). Returns the clique total.
+    long long tallyCliques(int h, vector<long long>& perVertex) const {
+        perVertex.assign(vertexCount, 0);
+        long long total = 0;
+        if (workerCount <= 1 || h <= 0) {
+            visitCliques(h, [&](const int* members) {
+                int i = 0;
+                while (i < h) {
+                    perVertex[members[i]]++;
+                    i++;
+                }
+                total++;
+            });
+            return total;
+        }
+
+        // Private tallies per thread, summed once every batch is done
+        vector<vector<long long>> workerTally(workerCount);
+        vector<long long> workerTotal(workerCount, 0);
+        enumerateOnPool(h, [&](const EnumerationTask&, int worker) {
+            vector<long long>* tally = &workerTally[worker];
+            long long* seen = &workerTotal[worker];
+            if (tally->empty()) tally->assign(vertexCount, 0);
+            return [tally, seen, h](const int* members) {
+                int i = 0;
+                while (i < h) {
+                    (*tally)[members[i]]++;
+                    i++;
+                }
+                (*seen)++;
+            };
+        });
+
+        auto meter = meterWorkers();
+        runTasks(workerCount, [&](int part) {
+            auto counters = meter(part);
+            int from = (long long)vertexCount * part / workerCount;
+            int to = (long long)vertexCount * (part + 1) / workerCount;
+            for (const auto& tally : workerTally) {
+                if (tally.empty()) continue;
+                int v = from;
+                while (v < to) {
+                    perVertex[v] += tally[v];
+                    v++;
+                }
+            }
+        });
+        for (long long seen : workerTotal) total += seen;
+        return total;
+    }
+
+    // Working memory of visitCliquesInside; callers that restrict to many
+    // vertex sets keep one alive so that the buffers are allocated only once
+    struct InsideScratch {
+        vector<char> chosen;
+        vector<int> members;
+        vector<vector<int>> frontier;
+        BitNeighbourhood bits;
+    };
+
+    // Visit every h-clique whose vertices all lie in `vertices`
+    template <class Visitor>
+    void visitCliquesInside(const vector<int>& vertices, int h, Visitor&& visit) const {
+        InsideScratch scratch;
+        visitCliquesInside(vertices, h, scratch, visit);
+    }
+
+    template <class Visitor>
+    void visitCliquesInside(const vector<int>& vertices, int h, InsideScratch& scratch, Visitor&& visit) const {
+        if (h <= 0 || vertices.empty()) return;
+        vector<char>& chosen = scratch.chosen;
+        chosen.resize(vertexCount, 0);
+        for (int v : vertices) chosen[v] = 1;
+
+        vector<int>& members = scratch.members;
+        vector<vector<int>>& frontier = scratch.frontier;
+        members.resize(h);
+        sizeFrontier(frontier, max(h, 2), degeneracyBound);
+        int* first = frontier[1].data();
+        for (int v : vertices) {
+            members[0] = v;
+            if (h == 1) {
+                visit(members.data());
+                continue;
+            }
+            int kept = 0;
+            for (int w : forwardOf(v)) {
+                if (chosen[w]) first[kept++] = w;
+            }
+            if (kept >= h - 1) {
+                expandClique(1, h, members, frontier, first, kept, visit);
+            }
+        }
+
+        // Hand the mask back cleared
+        for (int v : vertices) chosen[v] = 0;
     }
 
     void prepareCliqueCache(int h) const {
         if (isCacheReady) return;
-        cout << "Preparing clique cache for h=" << h << "... " << flush;
+        PhaseClock clock(metrics.cliques, perfPhases.cliques);
         auto startTime = chrono::high_resolution_clock::now();
+        string persistedPath = persistDirectory.empty() ? string() : persistedCachePath(h);
+        if (!persistedPath.empty() && restoreCliqueCache(persistedPath, h)) {
+            auto endTime = chrono::high_resolution_clock::now();
+            progressOutput() << "Restored clique cache " << persistedPath << " (" << cliqueTotalH << " h-cliques, "
+                 << cliqueCacheHMinus1.size() << " (h-1)-cliques) in "
+                 << chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count() << "ms." << endl;
+            isCacheReady = true;
+            return;
+        }
 
-        cliqueCacheH.clear();
-        cliqueCacheHMinus1.clear();
-        vertexCliqueMapping.resize(vertexCount);
+        progressOutput() << "Preparing clique cache for h=" << h << "... " << flush;
+
+        cliqueCacheHMinus1.clearWithStride(h - 1);
 
         try {
-            detectCliques(h, cliqueCacheH);
+            cliqueTotalH = tallyCliques(h, cliqueDegreeH);
             if (h > 1) {
                 detectCliques(h - 1, cliqueCacheHMinus1);
             }
-
-            size_t cliqueIdx = 0;
-            while (cliqueIdx < cliqueCacheH.size()) {
-                for (int v : cliqueCacheH[cliqueIdx]) {
-                    if (v >= 0 && v < vertexCount) {
-                        vertexCliqueMapping[v].push_back(cliqueIdx);
-                    }
-                }
-                cliqueIdx++;
-            }
+            metrics.cliquesListed += cliqueTotalH + cliqueCacheHMinus1.size();
 
             auto endTime = chrono::high_resolution_clock::now();
             auto duration = chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
-            cout << " Completed! Discovered " << cliqueCacheH.size() << " h-cliques and "
+            progressOutput() << " Completed! Counted " << cliqueTotalH << " h-cliques and stored "
                  << cliqueCacheHMinus1.size() << " (h-1)-cliques in " << duration << "ms." << endl;
             isCacheReady = true;
+
+            if (!persistedPath.empty() && !persistCliqueCache(persistedPath, h)) {
+                cerr << "Warning: Unable to write clique cache " << persistedPath << "." << endl;
+            }
         } catch (const exception& e) {
             cout << "Error during clique cache preparation: " << e.what() << endl;
-            cliqueCacheH.clear();
-            cliqueCacheHMinus1.clear();
+            cliqueDegreeH.assign(vertexCount, 0);
+            cliqueTotalH = 0;
+            cliqueCacheHMinus1.clearWithStride(h - 1);
         }
     }
 
-    const vector<vector<int>>& fetchHCliques(int h) const {
-        prepareCliqueCache(h);
-        return cliqueCacheH;
-    }
-
-    const vector<vector<int>>& fetchHMinus1Cliques(int h) const {
+    const CliqueArena& fetchHMinus1Cliques(int h) const {
         prepareCliqueCache(h);
         return cliqueCacheHMinus1;
     }
 
-    int getCliqueDegree(int v, int h) const {
+    long long getCliqueDegree(int v, int h) const {
         if (v < 0 || v >= vertexCount) return 0;
         prepareCliqueCache(h);
-        return vertexCliqueMapping[v].size();
+        return cliqueDegreeH[v];
     }
 
-    int computeMaxCliqueDegree(int h) const {
+    long long computeMaxCliqueDegree(int h) const {
         prepareCliqueCache(h);
-        int maxDeg = 0;
+        long long maxDeg = 0;
         int v = 0;
         while (v < vertexCount) {
-            maxDeg = max(maxDeg, static_cast<int>(vertexCliqueMapping[v].size()));
+            maxDeg = max(maxDeg, cliqueDegreeH[v]);
             v++;
         }
         return maxDeg;
     }
 
-    int countHCliques(int h) const {
+    // (k,Ψ)-core decomposition with Ψ the h-clique: repeatedly peel a vertex
+    // of minimum remaining h-clique degree from a bucket queue. The cliques
+    // lost with it are re-enumerated locally, as (h-1)-cliques among its
+    // surviving neighbours, and each of their members drops one bucket.
+    // coreNumber[v] is the largest k whose (k,Ψ)-core contains v.
+    long long decomposeCliqueCores(int h, vector<long long>& coreNumber) const {
+        prepareCliqueCache(h);
+        coreNumber.assign(vertexCount, 0);
+        if (vertexCount == 0) return 0;
+
+        long long topDegree = computeMaxCliqueDegree(h);
+        vector<long long> liveDegree(cliqueDegreeH);
+        vector<int> bucketHead(topDegree + 2, 0), slotOf(vertexCount), peelSequence(vertexCount);
+        int u = 0;
+        while (u < vertexCount) {
+            bucketHead[liveDegree[u] + 1]++;
+            u++;
+        }
+        long long d = 0;
+        while (d <= topDegree) {
+            bucketHead[d + 1] += bucketHead[d];
+            d++;
+        }
+        vector<int> nextSlot(bucketHead.begin(), bucketHead.end() - 1);
+        u = 0;
+        while (u < vertexCount) {
+            slotOf[u] = nextSlot[liveDegree[u]]++;
+            peelSequence[slotOf[u]] = u;
+            u++;
+        }
+
+        vector<char> alive(vertexCount, 1);
+        vector<int> members(max(h - 1, 1));
+        vector<int> alivePool;
+        vector<vector<int>> frontier;
+        sizeFrontier(frontier, max(h - 1, 1), degeneracyBound);
+        long long coreMax = 0;
+        int i = 0;
+        while (i < vertexCount) {
+            u = peelSequence[i];
+            alive[u] = 0;
+            coreNumber[u] = liveDegree[u];
+            coreMax = max(coreMax, liveDegree[u]);
+
+            auto loseClique = [&](const int* rest) {
+                int k = 0;
+                while (k < h - 1) {
+                    int w = rest[k++];
+                    if (liveDegree[w] <= liveDegree[u]) continue;
+                    long long bucket = liveDegree[w];
+                    int front = max(bucketHead[bucket], i + 1);
+                    int x = peelSequence[front];
+                    swap(peelSequence[front], peelSequence[slotOf[w]]);
+                    swap(slotOf[x], slotOf[w]);
+                    bucketHead[bucket] = front + 1;
+                    liveDegree[w]--;
+                }
+            };
+
+            if (h >= 2 && liveDegree[u] > 0) {
+                alivePool.clear();
+                for (int w : adjacentTo(u)) {
+                    if (alive[w]) alivePool.push_back(w);
+                }
+                if ((int)alivePool.size() >= h - 1) {
+                    expandClique(0, h - 1, members, frontier, alivePool.data(), alivePool.size(), loseClique);
+                }
+            }
+            i++;
+        }
+        return coreMax;
+    }
+
+    // Number of h-cliques inside the vertex set
+    long long countCliquesInside(const vector<int>& vertices, int h) const {
+        InsideScratch scratch;
+        return countCliquesInside(vertices, h, scratch);
+    }
+
+    long long countCliquesInside(const vector<int>& vertices, int h, InsideScratch& scratch) const {
+        if (h <= 0) return 0;
+        if (h == 1) return vertices.size();
+        vector<char>& chosen = scratch.chosen;
+        chosen.resize(vertexCount, 0);
+        for (int v : vertices) chosen[v] = 1;
+        sizeFrontier(scratch.frontier, h, degeneracyBound);
+
+        long long inside = 0;
+        int* first = scratch.frontier[1].data();
+        for (int v : vertices) {
+            int kept = 0;
+            for (int w : forwardOf(v)) {
+                if (chosen[w]) first[kept++] = w;
+            }
+            if (kept < h - 1) continue;
+            if (h >= 3 && kept <= BIT_NEIGHBOURHOOD_CAP) {
+                loadBitNeighbourhood(first, kept, h, scratch.bits);
+                inside += countBitExpansions(1, h, scratch.bits);
+            } else {
+                inside += countExpansions(1, h, scratch.frontier, first, kept);
+            }
+        }
+
+        for (int v : vertices) chosen[v] = 0;
+        return inside;
+    }
+
+    long long countHCliques(int h) const {
         prepareCliqueCache(h);
-        return cliqueCacheH.size();
+        return cliqueTotalH;
     }
 
     double computeCliqueDensity(int h) const {
-        int cliqueCount = countHCliques(h);
+        long long cliqueCount = countHCliques(h);
         if (vertexCount == 0) return 0.0;
         return static_cast<double>(cliqueCount) / vertexCount;
     }
@@ -222,119 +1079,61 @@ public:
 
         i = 0;
         while (i < vertices.size()) {
-            size_t j = i + 1;
-            while (j < vertices.size()) {
-                int u = vertices[i], v = vertices[j];
-                if (u >= 0 && u < vertexCount && v >= 0 && v < vertexCount && edgeExists(u, v)) {
-                    subgraph.insertEdge(vertexIndexMap[u], vertexIndexMap[v]);
+            int u = vertices[i];
+            if (u >= 0 && u < vertexCount) {
+                for (int v : adjacentTo(u)) {
+                    if (v <= u) continue;
+                    auto found = vertexIndexMap.find(v);
+                    if (found != vertexIndexMap.end()) {
+                        subgraph.insertEdge(i, found->second);
+                    }
                 }
-                j++;
             }
             i++;
         }
+        subgraph.compactAdjacency();
         return subgraph;
     }
 };
 
-// Dinic's max-flow algorithm
-int computeDinicFlow(const vector<vector<int>>& capacities, int source, int sink, vector<int>& cutVertices) {
-    int nodeCount = capacities.size();
-    if (source < 0 || source >= nodeCount || sink < 0 || sink >= nodeCount) {
-        cerr << "Invalid source/sink in flow computation." << endl;
-        return 0;
+// Connected components of the subgraph induced by the vertices of pool whose
+// core number is at least level
+vector<vector<int>> splitCoreComponents(const GraphStructure& graph, const vector<int>& pool,
+                                        const vector<long long>& coreNumber, long long level) {
+    vector<vector<int>> components;
+    vector<char> state(graph.getTotalVertices(), 0); // 1 = eligible, 2 = visited
+    for (int v : pool) {
+        if (coreNumber[v] >= level) state[v] = 1;
     }
-
-    vector<vector<int>> flow(nodeCount, vector<int>(nodeCount, 0));
-    vector<int> levels(nodeCount);
-    vector<int> nextEdge(nodeCount);
-
-    auto buildLevelGraph = [&]() -> bool {
-        fill(levels.begin(), levels.end(), -1);
-        levels[source] = 0;
-        queue<int> q;
-        q.push(source);
-
-        while (!q.empty()) {
-            int u = q.front();
-            q.pop();
-            int v = 0;
-            while (v < nodeCount) {
-                if (levels[v] < 0 && capacities[u][v] > flow[u][v]) {
-                    levels[v] = levels[u] + 1;
-                    q.push(v);
+    for (int root : pool) {
+        if (state[root] != 1) continue;
+        vector<int> component{root};
+        state[root] = 2;
+        size_t head = 0;
+        while (head < component.size()) {
+            int u = component[head++];
+            for (int v : graph.adjacentTo(u)) {
+                if (state[v] == 1) {
+                    state[v] = 2;
+                    component.push_back(v);
                 }
-                v++;
             }
         }
-        return levels[sink] >= 0;
-    };
-
-    function<int(int, int)> findBlockingFlow = [&](int u, int flowCap) -> int {
-        if (u == sink) return flowCap;
-        int& i = nextEdge[u];
-        while (i < nodeCount) {
-            int v = i;
-            if (levels[v] == levels[u] + 1 && capacities[u][v] > flow[u][v]) {
-                int bottleneck = findBlockingFlow(v, min(flowCap, capacities[u][v] - flow[u][v]));
-                if (bottleneck > 0) {
-                    flow[u][v] += bottleneck;
-                    flow[v][u] -= bottleneck;
-                    return bottleneck;
-                }
-            }
-            i++;
-        }
-        return 0;
-    };
-
-    int totalFlow = 0;
-    int iterationCount = 0;
-    cout << "Executing Dinic's flow algorithm: " << flush;
-
-    while (buildLevelGraph()) {
-        iterationCount++;
-        if (iterationCount % 10 == 0) {
-            cout << "*" << flush;
-        }
-        fill(nextEdge.begin(), nextEdge.end(), 0);
-        int pushed;
-        while ((pushed = findBlockingFlow(source, numeric_limits<int>::max())) > 0) {
-            totalFlow += pushed;
-        }
-    }
-    cout << " Finished!" << endl;
-
-    vector<bool> visited(nodeCount, false);
-    queue<int> q;
-    q.push(source);
-    visited[source] = true;
-
-    while (!q.empty()) {
-        int u = q.front();
-        q.pop();
-        int v = 0;
-        while (v < nodeCount) {
-            if (capacities[u][v] > flow[u][v] && !visited[v]) {
-                visited[v] = true;
-                q.push(v);
-            }
-            v++;
-        }
-    }
-
-    cutVertices.clear();
-    int i = 0;
-    while (i < nodeCount) {
-        if (visited[i]) {
-            cutVertices.push_back(i);
-        }
-        i++;
+        components.push_back(component);
     }
-    return totalFlow;
+    return components;
 }
 
-// ptimized clique-densest subgraph detection
-GraphStructure findOptimalCliqueSubgraph(const GraphStructure& graph, int h) {
+// CoreExact: clique-densest subgraph search restricted to (k,Ψ)-cores.
+// The densest subgraph lies in the (ceil(ρ*),Ψ)-core, so every flow network
+// is built on one connected component of the core at the current lower bound,
+// and components are re-pruned whenever that bound rises. By default each
+// component runs Dinkelbach steps: α is the exact best density c/k so far,
+// capacities are scaled by k to stay integral, and a component is closed
+// once its trivial cut {source} is minimum. bisect first binary-searches the
+// integral sink capacity to within 1/h of the optimum, then certifies the
+// result with the same Dinkelbach steps.
+GraphStructure findOptimalCliqueSubgraph(const GraphStructure& graph, int h, MaxFlowSolver& engine, bool bisect) {
     int n = graph.getTotalVertices();
     cout << " Processing graph with " << n << " vertices for " << h << "-clique densest subgraph." << endl;
 
@@ -344,7 +1143,7 @@ GraphStructure findOptimalCliqueSubgraph(const GraphStructure& graph, int h) {
     }
 
     cout << "Computing maximum " << h << "-clique degree... " << flush;
-    int maxDegree = graph.computeMaxCliqueDegree(h);
+    long long maxDegree = graph.computeMaxCliqueDegree(h);
     cout << "Max degree: " << maxDegree << endl;
 
     if (maxDegree == 0) {
@@ -352,289 +1151,579 @@ GraphStructure findOptimalCliqueSubgraph(const GraphStructure& graph, int h) {
         return graph;
     }
 
-    const auto& hCliques = graph.fetchHCliques(h);
     const auto& hMinus1Cliques = graph.fetchHMinus1Cliques(h);
 
-    if (hCliques.empty() || (h > 1 && hMinus1Cliques.empty())) {
+    if (graph.countHCliques(h) == 0 || (h > 1 && hMinus1Cliques.empty())) {
         cout << "Insufficient cliques for analysis." << endl;
         return graph;
     }
 
-    double lowerBound = 0, upperBound = maxDegree;
-    double precisionThreshold = 1.0 / (n * n);
-    vector<int> currentSubgraph, optimalSubgraph;
-    double optimalDensity = 0;
-    int iterationCount = 0;
-    const int MAX_BINARY_SEARCH = 20;
+    cout << "Peeling (k,Ψ)-cores... " << flush;
+    vector<long long> coreNumber;
+    long long kMax;
+    {
+        PhaseClock clock(metrics.cliques, perfPhases.cliques);
+        kMax = graph.decomposeCliqueCores(h, coreNumber);
+    }
+    cout << "maximum core number " << kMax << endl;
+
+    GraphStructure::InsideScratch insideScratch;
+    // The kMax-core gives the initial lower bound (at least kMax / h)
+    vector<int> optimalSubgraph;
+    int v = 0;
+    while (v < n) {
+        if (coreNumber[v] == kMax) optimalSubgraph.push_back(v);
+        v++;
+    }
+    long long optimalCliques = graph.countCliquesInside(optimalSubgraph, h, insideScratch);
+    long long optimalSize = optimalSubgraph.size();
+    double optimalDensity = (double)optimalCliques / optimalSize;
+    cout << "Initial lower bound from the " << kMax << "-core: " << optimalDensity << endl;
+
+    // Scaled capacities reach k * h * C <= n * h * C; beyond that the
+    // Dinkelbach network would not be exact. The binary search alone then
+    // gives a density within 1/h of the optimum, without a certificate.
+    bool certifiable = (double)n * h * graph.countHCliques(h) < (double)INF_CAPACITY / 2;
+    if (!certifiable) {
+        cout << "Scaled capacities would overflow; using binary search without certification." << endl;
+        bisect = true;
+    }
 
-    cout << " Initiating binary search: " << flush;
+    vector<int> everyVertex(n);
+    v = 0;
+    while (v < n) {
+        everyVertex[v] = v;
+        v++;
+    }
+    long long pruneLevel = (long long)ceil(optimalDensity);
+    vector<vector<int>> pending = splitCoreComponents(graph, everyVertex, coreNumber, pruneLevel);
+    cout << "(" << pruneLevel << ",Ψ)-core splits into " << pending.size() << " components." << endl;
+
+    vector<int> localId(n, -1);
+    int componentsSolved = 0;
+
+    // Buffers shared by all components and search steps; after the first
+    // few components they have grown large enough and stop reallocating
+    FlowNetwork network(0);
+    vector<int> componentCliques, sourceArcOf, sinkArcOf, extenders, buffer, minCut, currentSubgraph;
+    vector<long long> sourceCapacity;
+    int flowSolves = 0;
+    ostream& progressLog = progressOutput();
+    engine.setLog(progressLog);
+
+    // (h-1)-cliques bucketed by their first member. A clique inside a
+    // component is anchored at one of its vertices, so gathering a
+    // component's cliques only visits the buckets of its own vertices.
+    vector<int> anchorBegin(n + 1, 0), anchoredCliques(hMinus1Cliques.size());
+    size_t cliqueIndex = 0;
+    while (cliqueIndex < hMinus1Cliques.size()) {
+        anchorBegin[hMinus1Cliques[cliqueIndex][0] + 1]++;
+        cliqueIndex++;
+    }
+    v = 0;
+    while (v < n) {
+        anchorBegin[v + 1] += anchorBegin[v];
+        v++;
+    }
+    vector<int> anchorFill(anchorBegin.begin(), anchorBegin.end() - 1);
+    cliqueIndex = 0;
+    while (cliqueIndex < hMinus1Cliques.size()) {
+        anchoredCliques[anchorFill[hMinus1Cliques[cliqueIndex][0]]++] = cliqueIndex;
+        cliqueIndex++;
+    }
 
     try {
-        while (upperBound - lowerBound >= precisionThreshold && iterationCount < MAX_BINARY_SEARCH) {
-            iterationCount++;
-            double progress = (upperBound - lowerBound) / maxDegree * 100.0;
-            cout << "\r4: Binary search progress: " << fixed << setprecision(1)
-                 << (100.0 - progress) << "% (α=" << lowerBound << ".." << upperBound << ") " << flush;
-
-            double alpha = (lowerBound + upperBound) / 2;
-            cout << "\n4: Constructing flow network for α=" << alpha << "... " << flush;
-
-            size_t nodeCount = 1 + n + min(hMinus1Cliques.size(), (size_t)100000) + 1;
-            if (nodeCount > 1000000) {
-                cout << "Network too large (" << nodeCount << " nodes). Applying sampling." << endl;
-                nodeCount = 1000000;
+        while (!pending.empty()) {
+            vector<int> component = pending.back();
+            pending.pop_back();
+
+            // A component's densest subgraph cannot exceed its largest core number
+            long long componentCore = 0;
+            for (int u : component) componentCore = max(componentCore, coreNumber[u]);
+            if (componentCore <= optimalDensity || (int)component.size() < h) {
+                metrics.componentsSkipped++;
+                continue;
             }
 
-            vector<vector<pair<int, int>>> sparseNetwork(nodeCount);
-            int source = 0, sink = nodeCount - 1, vertexStart = 1, cliqueStart = vertexStart + n;
-
-            int v = 0;
-            while (v < n) {
-                int cap = graph.getCliqueDegree(v, h);
-                if (cap > 0) {
-                    sparseNetwork[source].push_back({vertexStart + v, cap});
+            // The lower bound may have risen since this component was queued;
+            // if it now holds vertices below the prune level, split it again
+            bool belowLevel = false;
+            for (int u : component) {
+                if (coreNumber[u] < pruneLevel) {
+                    belowLevel = true;
+                    break;
                 }
-                v++;
             }
-
-            v = 0;
-            while (v < n) {
-                sparseNetwork[vertexStart + v].push_back({sink, ceil(alpha * h)});
-                v++;
+            if (belowLevel) {
+                vector<vector<int>> pieces = splitCoreComponents(graph, component, coreNumber, pruneLevel);
+                for (auto& piece : pieces) pending.push_back(move(piece));
+                continue;
+            }
+            componentsSolved++;
+            metrics.componentsSolved++;
+
+            int size = component.size();
+            size_t idx = 0;
+            while (idx < component.size()) {
+                localId[component[idx]] = idx;
+                idx++;
             }
 
-            cout << "Adding flow network edges... " << flush;
-            const size_t CLIQUE_PROCESS_LIMIT = min(hMinus1Cliques.size(), (size_t)10000);
-            cout << "Processing " << CLIQUE_PROCESS_LIMIT << " of " << hMinus1Cliques.size() << " cliques..." << endl;
-
-            size_t i = 0;
-            while (i < CLIQUE_PROCESS_LIMIT && i < hMinus1Cliques.size()) {
-                if (cliqueStart + i >= nodeCount) break;
-                const auto& clique = hMinus1Cliques[i];
-                for (int v : clique) {
-                    if (v >= 0 && v < n && vertexStart + v < nodeCount) {
-                        sparseNetwork[cliqueStart + i].push_back({vertexStart + v, numeric_limits<int>::max()});
-                    }
-                }
-
-                int v = 0;
-                while (v < n) {
-                    if (find(clique.begin(), clique.end(), v) != clique.end()) {
-                        v++;
-                        continue;
-                    }
-                    bool extendable = true;
-                    for (int u : clique) {
-                        if (!graph.edgeExists(v, u)) {
-                            extendable = false;
+            unique_ptr<PhaseClock> assembling(new PhaseClock(metrics.network, perfPhases.network));
+            componentCliques.clear();
+            for (int anchor : component) {
+                int slot = anchorBegin[anchor];
+                while (slot < anchorBegin[anchor + 1]) {
+                    bool inside = true;
+                    for (int u : hMinus1Cliques[anchoredCliques[slot]]) {
+                        if (localId[u] < 0) {
+                            inside = false;
                             break;
                         }
                     }
-                    if (extendable && vertexStart + v < nodeCount && cliqueStart + i < nodeCount) {
-                        sparseNetwork[vertexStart + v].push_back({cliqueStart + i, 1});
-                    }
-                    v++;
+                    if (inside) componentCliques.push_back(anchoredCliques[slot]);
+                    slot++;
                 }
-                i++;
             }
 
-            vector<vector<int>> capacityMatrix;
-            if (nodeCount > 100000) {
-                cout << "Using sparse flow computation for large network..." << endl;
-                unordered_set<int> activeNodes;
-                activeNodes.insert(source);
-                activeNodes.insert(sink);
+            // Source capacities are h-clique degrees counted inside the component
+            sourceCapacity.assign(size, 0);
+            long long componentHCliques = 0;
+            graph.visitCliquesInside(component, h, insideScratch, [&](const int* members) {
+                componentHCliques++;
+                int k = 0;
+                while (k < h) {
+                    sourceCapacity[localId[members[k]]]++;
+                    k++;
+                }
+            });
+
+            progressLog << "4: Component " << componentsSolved << " with " << size << " vertices, core bound "
+                 << componentCore << endl;
+
+            // One network per component; the binary search only retunes sink arcs
+            progressLog << "4: Constructing flow network... " << flush;
+            int nodeCount = 1 + size + componentCliques.size() + 1;
+            network.recycle(nodeCount);
+            network.reserveArcs(2 * (size_t)size + (size_t)(h - 1) * componentCliques.size() +
+                                (size_t)h * componentHCliques);
+            int source = 0, sink = nodeCount - 1, vertexStart = 1, cliqueStart = vertexStart + size;
+
+            sourceArcOf.assign(size, -1);
+            sinkArcOf.resize(size);
+            int x = 0;
+            while (x < size) {
+                if (sourceCapacity[x] > 0) {
+                    sourceArcOf[x] = network.addArc(source, vertexStart + x, sourceCapacity[x]);
+                }
+                sinkArcOf[x] = network.addArc(vertexStart + x, sink, 0);
+                x++;
+            }
 
-                int u = 0;
-                while (u < nodeCount) {
-                    if (!sparseNetwork[u].empty()) {
-                        activeNodes.insert(u);
-                        for (const auto& edge : sparseNetwork[u]) {
-                            activeNodes.insert(edge.first);
-                        }
+            size_t k = 0;
+            while (k < componentCliques.size()) {
+                CliqueArena::Row clique = hMinus1Cliques[componentCliques[k]];
+                for (int w : clique) {
+                    network.addArc(cliqueStart + k, vertexStart + localId[w], INF_CAPACITY);
+                }
+
+                // Extensions are the clique's shared neighbours inside the component
+                graph.sharedNeighbours(clique.begin(), clique.size(), extenders, buffer);
+                for (int w : extenders) {
+                    if (localId[w] >= 0) {
+                        network.addArc(vertexStart + localId[w], cliqueStart + k, 1);
                     }
-                    u++;
+                }
+                k++;
+            }
+            network.build();
+            assembling.reset();
+            metrics.flowNetworks++;
+            metrics.flowNodes += nodeCount;
+            metrics.flowArcs += network.head.size() / 2;
+            metrics.cliquesListed += componentHCliques;
+            progressLog << nodeCount << " nodes, " << network.head.size() / 2 << " arcs." << endl;
+
+            int iterationCount = 0;
+            bool reprune = false;
+
+            // Binary search on the sink capacity m, with source arcs at deg
+            // and extension arcs at 1: the cut {source} is minimum exactly
+            // when nothing in the component is denser than m/h, so every
+            // step is exact. It narrows the optimum to within 1/h, and the
+            // Dinkelbach steps below then certify it.
+            long long sinkLow = h * optimalCliques / optimalSize, sinkHigh = h * componentCore;
+            while (bisect && sinkHigh - sinkLow > 1) {
+                iterationCount++;
+                flowSolves++;
+                metrics.searchIterations++;
+                metrics.flowSolves++;
+                long long sinkCapacity = sinkLow + (sinkHigh - sinkLow) / 2;
+                progressLog << "4: Binary search at α=" << sinkCapacity << "/" << h << " = " << fixed
+                     << setprecision(6) << (double)sinkCapacity / h << " (sink " << sinkLow << ".." << sinkHigh
+                     << ")... " << flush;
+
+                x = 0;
+                while (x < size) {
+                    engine.setSinkCapacity(network, sinkArcOf[x], sinkCapacity);
+                    x++;
                 }
 
-                unordered_map<int, int> nodeMapping;
-                int idx = 0;
-                for (int node : activeNodes) {
-                    nodeMapping[node] = idx++;
+                {
+                    PhaseClock clock(metrics.flow, perfPhases.flow);
+                    if (iterationCount == 1) {
+                        engine.minCut(network, source, sink, minCut);
+                    } else {
+                        engine.resolve(network, source, sink, minCut);
+                    }
                 }
 
-                capacityMatrix.resize(idx, vector<int>(idx, 0));
-                u = 0;
-                while (u < nodeCount) {
-                    if (activeNodes.count(u)) {
-                        for (const auto& edge : sparseNetwork[u]) {
-                            if (activeNodes.count(edge.first)) {
-                                capacityMatrix[nodeMapping[u]][nodeMapping[edge.first]] = edge.second;
-                            }
-                        }
+                currentSubgraph.clear();
+                for (int node : minCut) {
+                    if (node >= vertexStart && node < cliqueStart) {
+                        currentSubgraph.push_back(component[node - vertexStart]);
                     }
-                    u++;
                 }
-                source = nodeMapping[source];
-                sink = nodeMapping[sink];
-            } else {
-                capacityMatrix.resize(nodeCount, vector<int>(nodeCount, 0));
-                int u = 0;
-                while (u < nodeCount) {
-                    for (const auto& edge : sparseNetwork[u]) {
-                        capacityMatrix[u][edge.first] = edge.second;
+                if (currentSubgraph.empty()) {
+                    sinkHigh = sinkCapacity;
+                    progressLog << "cut only includes source, nothing is denser" << endl;
+                    continue;
+                }
+
+                sinkLow = sinkCapacity;
+                long long inside = graph.countCliquesInside(currentSubgraph, h, insideScratch);
+                progressLog << "cut has " << currentSubgraph.size() << " vertices with density "
+                     << (double)inside / currentSubgraph.size() << endl;
+                if ((__int128)inside * optimalSize > (__int128)optimalCliques * (long long)currentSubgraph.size()) {
+                    optimalSubgraph = currentSubgraph;
+                    optimalCliques = inside;
+                    optimalSize = currentSubgraph.size();
+                    optimalDensity = (double)optimalCliques / optimalSize;
+                    sinkLow = max(sinkLow, h * optimalCliques / optimalSize);
+
+                    // A higher bound selects a smaller core: re-prune this component
+                    if ((long long)ceil(optimalDensity) > pruneLevel) {
+                        pruneLevel = (long long)ceil(optimalDensity);
+                        reprune = true;
+                        break;
                     }
-                    u++;
                 }
             }
 
-            sparseNetwork.clear();
-            vector<int> minCut;
-            computeDinicFlow(capacityMatrix, source, sink, minCut);
-            capacityMatrix.clear();
+            // Dinkelbach: with α = c/k, source arcs carry k * deg, extension
+            // arcs k and sink arcs h * c, so a source side S costs
+            // k*h*C - h*(k*C(S) - c*|S|) and beats the cut {source} exactly
+            // when S is denser than c/k
+            while (certifiable && !reprune) {
+                long long divisor = gcd(optimalCliques, optimalSize);
+                long long numerator = optimalCliques / divisor, scale = optimalSize / divisor;
+                flowSolves++;
+                metrics.searchIterations++;
+                metrics.flowSolves++;
+                progressLog << "4: Dinkelbach step at α=" << numerator << "/" << scale << " = " << fixed
+                     << setprecision(6) << optimalDensity << "... " << flush;
+
+                x = 0;
+                while (x < size) {
+                    if (sourceArcOf[x] >= 0) network.capacity[sourceArcOf[x]] = scale * sourceCapacity[x];
+                    network.capacity[sinkArcOf[x]] = h * numerator;
+                    x++;
+                }
+                size_t arc = 0;
+                while (arc < network.head.size()) {
+                    int from = network.tailOf(arc), to = network.head[arc];
+                    if (from >= vertexStart && from < cliqueStart && to >= cliqueStart && to != sink) {
+                        network.capacity[arc] = scale;
+                    }
+                    arc += 2;
+                }
+
+                // All capacities move with the scale, so every step starts from zero flow
+                Capacity cutValue;
+                {
+                    PhaseClock clock(metrics.flow, perfPhases.flow);
+                    cutValue = engine.minCut(network, source, sink, minCut);
+                }
+                Capacity trivialCut = (Capacity)scale * h * componentHCliques;
+                if (cutValue >= trivialCut) {
+                    progressLog << "4: Certified: minimum cut " << cutValue << " equals the cut {source} = "
+                         << scale << "*" << h << "*" << componentHCliques << ", nothing in this component beats "
+                         << numerator << "/" << scale << endl;
+                    break;
+                }
 
-            if (minCut.size() <= 1) {
-                upperBound = alpha;
-                cout << "Cut only includes source. Adjusting upper bound to " << upperBound << endl;
-            } else {
-                lowerBound = alpha;
                 currentSubgraph.clear();
                 for (int node : minCut) {
-                    if (node != source && node >= vertexStart && node < cliqueStart) {
-                        int origVertex = node - vertexStart;
-                        if (origVertex >= 0 && origVertex < n) {
-                            currentSubgraph.push_back(origVertex);
-                        }
+                    if (node >= vertexStart && node < cliqueStart) {
+                        currentSubgraph.push_back(component[node - vertexStart]);
                     }
                 }
+                long long inside = currentSubgraph.empty() ? 0 : graph.countCliquesInside(currentSubgraph, h, insideScratch);
+                if (currentSubgraph.empty() || (__int128)inside * optimalSize <= (__int128)optimalCliques * (long long)currentSubgraph.size()) {
+                    progressLog << "4: Cut " << cutValue << " below " << trivialCut << " without a denser source side; stopping." << endl;
+                    break;
+                }
 
-                if (!currentSubgraph.empty()) {
-                    if (currentSubgraph.size() < 1000) {
-                        GraphStructure subgraph = graph.extractSubgraph(currentSubgraph);
-                        double density = subgraph.computeCliqueDensity(h);
-                        if (density > optimalDensity) {
-                            optimalDensity = density;
-                            optimalSubgraph = currentSubgraph;
-                        }
-                        cout << "Cut has " << currentSubgraph.size() << " vertices, density " << density
-                             << ". Raising lower bound to " << lowerBound << endl;
-                    } else {
-                        optimalSubgraph = currentSubgraph;
-                        cout << "Cut has " << currentSubgraph.size() << " vertices. Raising lower bound to "
-                             << lowerBound << endl;
-                    }
+                optimalSubgraph = currentSubgraph;
+                optimalCliques = inside;
+                optimalSize = currentSubgraph.size();
+                optimalDensity = (double)optimalCliques / optimalSize;
+                progressLog << "4: Cut " << cutValue << " < " << trivialCut << ": " << optimalSize
+                     << " vertices with density " << optimalDensity << endl;
+
+                // A higher bound selects a smaller core: re-prune this component
+                if ((long long)ceil(optimalDensity) > pruneLevel) {
+                    pruneLevel = (long long)ceil(optimalDensity);
+                    reprune = true;
+                    break;
                 }
             }
+
+            for (int u : component) localId[u] = -1;
+
+            if (reprune) {
+                vector<vector<int>> pieces = splitCoreComponents(graph, component, coreNumber, pruneLevel);
+                progressLog << "Lower bound rose to " << optimalDensity << "; re-pruned to (" << pruneLevel
+                     << ",Ψ)-core, " << pieces.size() << " components." << endl;
+                for (auto& piece : pieces) pending.push_back(move(piece));
+            }
         }
     } catch (const exception& e) {
         cout << "Error in binary search: " << e.what() << endl;
         cout << "Falling back to best subgraph found." << endl;
     }
 
-    cout << "\nBinary search concluded. Estimated density: " << lowerBound << endl;
+    if (!certifiable) {
+        cout << "\nBinary search concluded after " << flowSolves << " flow solves. Density " << optimalDensity
+             << " is within 1/" << h << " of optimal (not certified)." << endl;
+    } else {
+        long long divisor = gcd(optimalCliques, optimalSize);
+        cout << "\n" << (bisect ? "Binary search with Dinkelbach certification" : "Dinkelbach search")
+             << " concluded after " << flowSolves << " flow solves. Every component is certified,"
+             << " so the optimal density is " << optimalCliques / divisor << "/" << optimalSize / divisor
+             << " = " << optimalDensity << endl;
+    }
 
     if (!optimalSubgraph.empty()) {
         return graph.extractSubgraph(optimalSubgraph);
-    } else if (!currentSubgraph.empty()) {
-        return graph.extractSubgraph(currentSubgraph);
     }
     return graph;
 }
 
+// Save the graph and original ids as <dataset>.csr (format in Common/snapshot.h)
+bool saveSnapshot(const string& path, const struct stat& origin, const GraphStructure& graph,
+                  const vector<int>& sourceId) {
+    SnapshotView layout;
+    layout.vertexCount = graph.getTotalVertices();
+    layout.adjacencyEntries = graph.rowEntries().size();
+    layout.dagEntries = graph.forwardEntries().size();
+    layout.degeneracy = graph.getDegeneracyBound();
+    int u = 0;
+    while (u < graph.getTotalVertices()) {
+        layout.maxDegree = max<int64_t>(layout.maxDegree, graph.vertexDegree(u));
+        u++;
+    }
+    layout.rowOffsets = graph.rowOffsets().data();
+    layout.rowNeighbors = graph.rowEntries().data();
+    layout.dagOffsets = graph.forwardOffsets().data();
+    layout.dagNeighbors = graph.forwardEntries().data();
+    layout.originalIds = sourceId.data();
+    return writeSnapshotFile(path, origin, layout);
+}
+
+// Build the graph directly on a mapped snapshot; false if it is missing,
+// malformed, of another revision or no longer matches the dataset
+bool mapSnapshot(const string& path, const struct stat& origin, unique_ptr<GraphStructure>& graph,
+                 IntArray& sourceId) {
+    shared_ptr<MappedFile> file;
+    SnapshotView layout;
+    if (!mapSnapshotFile(path, origin, file, layout)) return false;
+
+    int n = layout.vertexCount;
+    graph.reset(new GraphStructure(n));
+    graph->attachSnapshot(file, layout.rowOffsets, layout.rowNeighbors, layout.dagOffsets, layout.dagNeighbors,
+                          layout.degeneracy);
+    sourceId.borrow(file, layout.originalIds, n);
+    cout << "Mapped snapshot " << path << " (" << n << " vertices, " << layout.adjacencyEntries / 2
+         << " edges, max degree " << layout.maxDegree << ", degeneracy " << layout.degeneracy << ")." << endl;
+    return true;
+}
+
+// Reuse a current snapshot if there is one; otherwise parse the dataset (or
+// stdin if it cannot be opened) and save a snapshot for the next run
+bool obtainGraph(const string& inputFile, int threadCount, unique_ptr<GraphStructure>& graph, IntArray& sourceId) {
+    struct stat origin;
+    bool fromFile = !inputFile.empty() && stat(inputFile.c_str(), &origin) == 0;
+    string snapshotPath = inputFile + ".csr";
+    if (fromFile && mapSnapshot(snapshotPath, origin, graph, sourceId)) {
+        return true;
+    }
+
+    // Map the dataset directly; otherwise the remainder of stdin is the graph
+    MappedFile view;
+    string consoleText;
+    EdgeList parsed;
+    if (fromFile && view.open(inputFile)) {
+        parsed = parseEdgeList(view.data(), view.size(), threadCount);
+    } else {
+        fromFile = false;
+        cout << "File not accessible, reading from standard input..." << endl;
+        consoleText.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+        parsed = parseEdgeList(consoleText.data(), consoleText.size(), threadCount);
+    }
+
+    int vertexCount = parsed.originalId.size();
+    long long edgeCount = parsed.edges.size();
+    if (vertexCount <= 0) {
+        cerr << "Invalid parameters: no edges in input." << endl;
+        return false;
+    }
+
+    if (vertexCount > 1000000) {
+        cerr << "Graph exceeds size limit of 1,000,000 vertices." << endl;
+        return false;
+    }
+
+    if (parsed.malformedLines > 0) {
+        cerr << "Warning: Ignored " << parsed.malformedLines << " malformed lines." << endl;
+    }
+    if (parsed.selfLoops > 0) {
+        cerr << "Warning: Ignored " << parsed.selfLoops << " self-loops." << endl;
+    }
+    if (vertexCount != parsed.declaredVertices || edgeCount != parsed.declaredEdges) {
+        cout << "Header lists " << parsed.declaredVertices << " vertices and " << parsed.declaredEdges
+             << " edges; input holds " << vertexCount << " vertices and " << edgeCount << " edge lines." << endl;
+    }
+
+    cout << "Initializing graph with " << vertexCount << " vertices and " << edgeCount
+         << " edges..." << endl;
+    graph.reset(new GraphStructure(vertexCount));
+    graph->adoptEdges(move(parsed.edges));
+
+    if (fromFile) {
+        if (saveSnapshot(snapshotPath, origin, *graph, parsed.originalId)) {
+            cout << "Saved snapshot " << snapshotPath << "." << endl;
+        } else {
+            cerr << "Warning: Unable to save snapshot " << snapshotPath << "." << endl;
+        }
+    }
+    sourceId.adopt(move(parsed.originalId));
+    return true;
+}
+
 int main(int argc, char** argv) {
     try {
         cout << "Loading graph data..." << endl;
-        unordered_map<int, int> vertexMapping;
-        ifstream inputStream;
-        string inputFile = argv[1];
-        inputStream.open(inputFile);
-
-        if (!inputStream.is_open()) {
-            cout << "File not accessible, reading from standard input..." << endl;
-            ofstream tempFile("temp_graph.txt");
-            string line;
-            while (getline(cin, line)) {
-                tempFile << line << endl;
-            }
-            tempFile.close();
-            inputStream.open("temp_graph.txt");
-            if (!inputStream.is_open()) {
-                cerr << "Failed to create temporary file!" << endl;
-                return 1;
+        string inputFile;
+        string engineName = "dinic";
+        bool reusePreflow = true;
+        string cacheDirectory = ".cliquecache";
+        int threadCount = max(1u, thread::hardware_concurrency());
+        string kernelName = "auto";
+        string searchName = "dinkelbach";
+        string metricsPath;
+        bool profileCounters = false;
+        int argIndex = 1;
+        while (argIndex < argc) {
+            string arg = argv[argIndex];
+            if (arg.rfind("--flow=", 0) == 0) {
+                engineName = arg.substr(7);
+            } else if (arg == "--cold-start") {
+                reusePreflow = false;
+            } else if (arg.rfind("--cache-dir=", 0) == 0) {
+                cacheDirectory = arg.substr(12);
+            } else if (arg == "--no-cache") {
+                cacheDirectory.clear();
+            } else if (arg.rfind("--threads=", 0) == 0) {
+                threadCount = max(1, atoi(arg.c_str() + 10));
+            } else if (arg.rfind("--simd=", 0) == 0) {
+                kernelName = arg.substr(7);
+            } else if (arg.rfind("--search=", 0) == 0) {
+                searchName = arg.substr(9);
+            } else if (arg == "--quiet") {
+                quietMode = true;
+            } else if (arg.rfind("--metrics=", 0) == 0) {
+                metricsPath = arg.substr(10);
+            } else if (arg == "--perf") {
+                profileCounters = true;
+            } else {
+                inputFile = arg;
             }
+            argIndex++;
         }
 
-        int vertexCount, edgeCount, cliqueSize, dummy;
-        cin >> cliqueSize;
-        inputStream >> vertexCount >> edgeCount;
-
-        if (vertexCount <= 0 || edgeCount < 0 || cliqueSize <= 0) {
-            cerr << "Invalid parameters: vertices=" << vertexCount << ", edges=" << edgeCount
-                 << ", cliqueSize=" << cliqueSize << endl;
+        unique_ptr<MaxFlowSolver> engine = makeMaxFlowSolver(engineName, reusePreflow);
+        if (!engine) {
+            cerr << "Unsupported flow engine: " << engineName << " (expected dinic, push-relabel or push-relabel-flow)" << endl;
             return 1;
         }
-
-        if (vertexCount > 1000000) {
-            cerr << "Graph exceeds size limit of 1,000,000 vertices." << endl;
+        if (searchName != "dinkelbach" && searchName != "bisect") {
+            cerr << "Unsupported search: " << searchName << " (expected dinkelbach or bisect)" << endl;
+            return 1;
+        }
+        if (!pickIntersectKernels(kernelName, intersectKernels)) {
+            cerr << "Unsupported intersection kernels: " << kernelName << " (expected auto, avx512, avx2, sse or scalar)" << endl;
             return 1;
         }
+        cout << "Intersection kernels: " << intersectKernels.name << endl;
+        string counterProblem;
+        if (profileCounters && !enablePerfCounters(counterProblem)) {
+            cout << "Hardware counters unavailable: " << counterProblem << "; running without --perf." << endl;
+        }
 
-        cout << "Initializing graph with " << vertexCount << " vertices and " << edgeCount
-             << " edges..." << endl;
-        GraphStructure graph(vertexCount);
+        int cliqueSize = 0;
+        cin >> cliqueSize;
+        if (cliqueSize <= 0) {
+            cerr << "Invalid parameters: cliqueSize=" << cliqueSize << endl;
+            return 1;
+        }
 
-        int invalidEdgeCount = 0, nodeIndex = 0;
-        int i = 0;
-        while (i < edgeCount) {
-            int u, v;
-            if (!(inputStream >> u >> v >> dummy)) {
-                cerr << "Error reading edge #" << i << endl;
-                break;
-            }
-            if (vertexMapping.count(u)) {
-                u = vertexMapping[u];
-            } else {
-                vertexMapping[u] = nodeIndex++;
-            }
-            if (vertexMapping.count(v)) {
-                v = vertexMapping[v];
-            } else {
-                vertexMapping[v] = nodeIndex++;
-            }
-            u = vertexMapping[u];
-            v = vertexMapping[v];
+        auto loadBegin = chrono::high_resolution_clock::now();
 
-            if (u < 0 || u >= vertexCount || v < 0 || v >= vertexCount) {
-                invalidEdgeCount++;
-                if (invalidEdgeCount < 10) {
-                    cerr << "Warning: Invalid edge (" << u << ", " << v << ")" << endl;
-                }
-            } else {
-                graph.insertEdge(u, v);
-            }
-            i++;
+        unique_ptr<GraphStructure> loadedGraph;
+        IntArray sourceId;
+        if (!obtainGraph(inputFile, threadCount, loadedGraph, sourceId)) {
+            return 1;
         }
-        inputStream.close();
+        GraphStructure& graph = *loadedGraph;
+        graph.usePersistDirectory(cacheDirectory);
+        graph.useWorkers(threadCount);
+        int vertexCount = graph.getTotalVertices();
 
-        if (invalidEdgeCount > 0) {
-            cerr << "Warning: Ignored " << invalidEdgeCount << " invalid edges." << endl;
-        }
+        auto loadFinish = chrono::high_resolution_clock::now();
+        cout << "Load time: " << chrono::duration_cast<chrono::milliseconds>(loadFinish - loadBegin).count()
+             << " ms on " << threadCount << " thread(s)." << endl;
 
-        cout << "Graph loaded: " << vertexCount << " vertices, " << edgeCount << " edges." << endl;
+        cout << "Graph loaded: " << vertexCount << " vertices, " << graph.getTotalEdges() << " edges." << endl;
         cout << "Searching for " << cliqueSize << "-clique densest subgraph..." << endl;
 
         auto startTime = chrono::high_resolution_clock::now();
-        GraphStructure denseSubgraph = findOptimalCliqueSubgraph(graph, cliqueSize);
+        cout << "Flow engine: " << engine->name() << endl;
+        GraphStructure denseSubgraph = findOptimalCliqueSubgraph(graph, cliqueSize, *engine, searchName == "bisect");
         auto endTime = chrono::high_resolution_clock::now();
-        auto duration = chrono::duration_cast<chrono::seconds>(endTime - startTime).count();
+        double duration = chrono::duration<double>(endTime - startTime).count();
 
-        cout << "\nExecution completed in " << duration << " seconds." << endl;
+        cout << "\nExecution completed in " << fixed << setprecision(3) << duration << " seconds." << endl;
+
+        // Single parseable summary line, consumed by Benchmark/benchmark.cpp
+        double loadMs = chrono::duration<double, milli>(loadFinish - loadBegin).count();
+        cout << "Timings (ms): load " << loadMs << ", cliques " << metrics.cliques / 1000.0
+             << ", network " << metrics.network / 1000.0 << ", flow " << metrics.flow / 1000.0
+             << ", total " << loadMs + duration * 1000 << endl;
+        if (perfEnabled) printPerfTotals();
+
+        // Exported before the clique count below re-lists the result, so the
+        // JSON agrees with the Timings line
+        if (!metricsPath.empty() && !writeMetrics(metricsPath, loadMs, loadMs + duration * 1000)) {
+            cerr << "Failed to write metrics: " << metricsPath << endl;
+        }
         cout << " Found clique-dense subgraph with " << denseSubgraph.getTotalVertices()
              << " vertices." << endl;
 
         if (denseSubgraph.getTotalVertices() < 10000) {
-            cout <<  cliqueSize << "-clique count: " << denseSubgraph.countHCliques(cliqueSize)
-                 << endl;
-            cout <<  cliqueSize << "-clique density: "
+            long long cliqueCount = denseSubgraph.countHCliques(cliqueSize);
+            cout <<  cliqueSize << "-clique count: " << cliqueCount << endl;
+            cout <<  cliqueSize << "-clique density: " << setprecision(6)
                  << denseSubgraph.computeCliqueDensity(cliqueSize) << endl;
         } else {
             cout << "Large subgraph detected, omitting detailed clique analysis." << endl;
@@ -0,0 +1,416 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// Benchmark driver: runs the compiled algo1 and CoreExact programs over every
+// dataset/*.txt for a grid of h values, several times each, and writes the
+// per-phase timings (median and variance) to JSON. Each run reads the
+// "Timings (ms): ..." line both programs print at the end. An untimed
+// warm-up run per dataset and program first writes the dataset's .csr
+// snapshot, so every timed run measures loading from the mapped snapshot
+// rather than one run parsing the text and the others mapping.
+
+// Phases in the order of the "Timings (ms)" line
+const char* PHASES[] = {"load", "cliques", "network", "flow", "total"};
+const int PHASE_COUNT = 5;
+
+// Lines announcing the size of the result, each followed by the vertex count:
+// "Clique-Dense Subgraph found with N vertices!" (algo1) and
+// " Found clique-dense subgraph with N vertices." (CoreExact)
+const char* SUBGRAPH_LINES[] = {"Clique-Dense Subgraph found with ", " Found clique-dense subgraph with "};
+
+struct Program {
+    string name;
+    string path;
+};
+
+// Outcome of one program on one dataset and h, over all repeats
+struct Measurement {
+    string program;
+    string dataset;
+    int h = 0;
+    int failures = 0;
+    int vertices = -1;
+    double density = -1;
+    vector<double> samples[PHASE_COUNT];
+};
+
+// Parsed output of a single run
+struct RunResult {
+    bool ok = false;
+    int vertices = -1;
+    double density = -1;
+    double phase[PHASE_COUNT] = {0, 0, 0, 0, 0};
+};
+
+// Clique sizes from a range "2..6" or a list "3,5,7", sorted and unique
+bool parseCliqueSizes(const string& text, vector<int>& sizes) {
+    sizes.clear();
+    size_t dots = text.find("..");
+    if (dots != string::npos) {
+        int first = atoi(text.substr(0, dots).c_str());
+        int last = atoi(text.substr(dots + 2).c_str());
+        for (int h = first; h <= last; h++) {
+            sizes.push_back(h);
+        }
+    } else {
+        size_t start = 0;
+        while (start <= text.size()) {
+            size_t comma = text.find(',', start);
+            if (comma == string::npos) comma = text.size();
+            sizes.push_back(atoi(text.substr(start, comma - start).c_str()));
+            start = comma + 1;
+        }
+    }
+    sort(sizes.begin(), sizes.end());
+    sizes.erase(unique(sizes.begin(), sizes.end()), sizes.end());
+    return !sizes.empty() && sizes.front() > 0;
+}
+
+// Edge-list files (*.txt) of a directory, sorted by name
+vector<string> listDatasets(const string& dir) {
+    vector<string> files;
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) return files;
+    while (dirent* entry = readdir(handle)) {
+        string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0) {
+            files.push_back(name);
+        }
+    }
+    closedir(handle);
+    sort(files.begin(), files.end());
+    return files;
+}
+
+// Quote a string for the shell
+string shellQuote(const string& text) {
+    string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+// Number following the last ':' of a line
+double valueAfterColon(const string& line) {
+    size_t colon = line.rfind(':');
+    return colon == string::npos ? -1 : atof(line.c_str() + colon + 1);
+}
+
+// Run one program on one dataset with h on standard input and pick the
+// timings, the subgraph size and its density out of the output
+RunResult runOnce(const Program& program, const string& dataset, int h, const string& arguments, int timeoutSeconds) {
+    string command = "printf '%d\\n' " + to_string(h) + " | ";
+    if (timeoutSeconds > 0) {
+        command += "timeout " + to_string(timeoutSeconds) + " ";
+    }
+    command += shellQuote(program.path) + " " + shellQuote(dataset) + " " + arguments + " 2>&1";
+
+    // "<h>-clique density of CDS: D" (algo1) or "<h>-clique density: D" (CoreExact)
+    string densityLine = to_string(h) + "-clique density of CDS:";
+    string densityLineCore = to_string(h) + "-clique density:";
+
+    RunResult result;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (!pipe) return result;
+
+    bool timed = false;
+    string line;
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        line += buffer;
+        if (line.empty() || line.back() != '\n') continue;
+
+        if (line.rfind("Timings (ms):", 0) == 0) {
+            // "Timings (ms): load L, cliques C, network N, flow F, total T"
+            timed = true;
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                size_t at = line.find(string(PHASES[p]) + " ");
+                if (at == string::npos) {
+                    timed = false;
+                    break;
+                }
+                result.phase[p] = atof(line.c_str() + at + strlen(PHASES[p]) + 1);
+            }
+        } else if (line.rfind(densityLine, 0) == 0 || line.rfind(densityLineCore, 0) == 0) {
+            result.density = valueAfterColon(line);
+        } else {
+            for (const char* prefix : SUBGRAPH_LINES) {
+                if (line.rfind(prefix, 0) == 0) result.vertices = atoi(line.c_str() + strlen(prefix));
+            }
+        }
+        line.clear();
+    }
+    int status = pclose(pipe);
+    result.ok = timed && status != -1 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return result;
+}
+
+double median(vector<double> values) {
+    if (values.empty()) return 0;
+    sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+// Sample variance (n - 1 in the denominator); 0 for fewer than two samples
+double variance(const vector<double>& values) {
+    if (values.size() < 2) return 0;
+    double mean = 0;
+    for (double v : values) {
+        mean += v;
+    }
+    mean /= values.size();
+    double sum = 0;
+    for (double v : values) {
+        sum += (v - mean) * (v - mean);
+    }
+    return sum / (values.size() - 1);
+}
+
+string jsonString(const string& text) {
+    string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+string jsonNumber(double value) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.10g", value);
+    return text;
+}
+
+// Write every measurement, plus tables shaped for the frontend components:
+// "heatmaps" hold [dataset][h] arrays for HeatmapTable (row labels are
+// "datasets", column labels "h"), "timeBars" hold [{name, value}] lists of
+// median total seconds for HistogramTimeChart. Missing results are null.
+void writeJson(ostream& out, const vector<Program>& programs, const vector<string>& datasets, const vector<int>& sizes,
+               int repeats, int warmups, const string& arguments, const vector<Measurement>& measurements) {
+    auto find = [&](const string& program, const string& dataset, int h) -> const Measurement* {
+        for (const auto& m : measurements) {
+            if (m.program == program && m.dataset == dataset && m.h == h) return &m;
+        }
+        return nullptr;
+    };
+    auto usable = [](const Measurement* m) {
+        return m && !m->samples[PHASE_COUNT - 1].empty();
+    };
+
+    out << "{\n  \"datasets\": [";
+    for (size_t d = 0; d < datasets.size(); d++) {
+        out << (d ? ", " : "") << jsonString(datasets[d]);
+    }
+    out << "],\n  \"h\": [";
+    for (size_t i = 0; i < sizes.size(); i++) {
+        out << (i ? ", " : "") << sizes[i];
+    }
+    out << "],\n  \"repeats\": " << repeats << ",\n  \"warmups\": " << warmups
+        << ",\n  \"arguments\": " << jsonString(arguments) << ",\n";
+
+    out << "  \"programs\": [\n";
+    for (size_t p = 0; p < programs.size(); p++) {
+        const string& name = programs[p].name;
+        out << "    {\n      \"name\": " << jsonString(name) << ",\n      \"runs\": [\n";
+        bool first = true;
+        for (const auto& m : measurements) {
+            if (m.program != name) continue;
+            out << (first ? "" : ",\n") << "        {\"dataset\": " << jsonString(m.dataset) << ", \"h\": " << m.h
+                << ", \"failures\": " << m.failures << ", \"vertices\": " << m.vertices
+                << ", \"density\": " << (m.density < 0 ? "null" : jsonNumber(m.density)) << ", \"phases\": {";
+            for (int ph = 0; ph < PHASE_COUNT; ph++) {
+                const vector<double>& samples = m.samples[ph];
+                out << (ph ? ", " : "") << "\"" << PHASES[ph] << "\": {\"median\": " << jsonNumber(median(samples))
+                    << ", \"variance\": " << jsonNumber(variance(samples)) << ", \"samples\": [";
+                for (size_t i = 0; i < samples.size(); i++) {
+                    out << (i ? ", " : "") << jsonNumber(samples[i]);
+                }
+                out << "]}";
+            }
+            out << "}}";
+            first = false;
+        }
+        out << "\n      ],\n      \"heatmaps\": {\n";
+
+        const char* tables[] = {"density", "totalSeconds"};
+        for (int table = 0; table < 2; table++) {
+            out << "        \"" << tables[table] << "\": [";
+            for (size_t d = 0; d < datasets.size(); d++) {
+                out << (d ? ", " : "") << "[";
+                for (size_t i = 0; i < sizes.size(); i++) {
+                    const Measurement* m = find(name, datasets[d], sizes[i]);
+                    out << (i ? ", " : "");
+                    if (!usable(m)) {
+                        out << "null";
+                    } else if (table == 0) {
+                        out << (m->density < 0 ? "null" : jsonNumber(m->density));
+                    } else {
+                        out << jsonNumber(median(m->samples[PHASE_COUNT - 1]) / 1000);
+                    }
+                }
+                out << "]";
+            }
+            out << "]" << (table == 0 ? ",\n" : "\n");
+        }
+        out << "      }\n    }" << (p + 1 < programs.size() ? ",\n" : "\n");
+    }
+    out << "  ],\n";
+
+    out << "  \"timeBars\": {\n";
+    for (size_t d = 0; d < datasets.size(); d++) {
+        out << "    " << jsonString(datasets[d]) << ": {";
+        for (size_t i = 0; i < sizes.size(); i++) {
+            out << (i ? ", " : "") << "\"" << sizes[i] << "\": [";
+            for (size_t p = 0; p < programs.size(); p++) {
+                const Measurement* m = find(programs[p].name, datasets[d], sizes[i]);
+                out << (p ? ", " : "") << "{\"name\": " << jsonString(programs[p].name) << ", \"value\": "
+                    << (usable(m) ? jsonNumber(median(m->samples[PHASE_COUNT - 1]) / 1000) : "null") << "}";
+            }
+            out << "]";
+        }
+        out << "}" << (d + 1 < datasets.size() ? ",\n" : "\n");
+    }
+    out << "  }\n}\n";
+}
+
+int main(int argc, char** argv) {
+    // Options: --algo1=<binary>, --coreexact=<binary> (empty skips a program),
+    // --datasets=<dir>, --h=<first..last or list>, --repeats=<n>,
+    // --args=<flags for both programs>, --timeout=<seconds per run>, --out=<file>,
+    // --warmups=<untimed runs per dataset and program, default 1>
+    vector<Program> programs = {{"algo1", "./algo1"}, {"CoreExact", "./coreexact"}};
+    string datasetDir = "dataset";
+    string cliqueSizes = "2..6";
+    int repeats = 5;
+    int warmups = 1;
+    string arguments = "--no-cache";
+    int timeoutSeconds = 0;
+    string outPath = "benchmark.json";
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--algo1=", 0) == 0) {
+            programs[0].path = arg.substr(8);
+        } else if (arg.rfind("--coreexact=", 0) == 0) {
+            programs[1].path = arg.substr(12);
+        } else if (arg.rfind("--datasets=", 0) == 0) {
+            datasetDir = arg.substr(11);
+        } else if (arg.rfind("--h=", 0) == 0) {
+            cliqueSizes = arg.substr(4);
+        } else if (arg.rfind("--repeats=", 0) == 0) {
+            repeats = max(1, atoi(arg.c_str() + 10));
+        } else if (arg.rfind("--warmups=", 0) == 0) {
+            warmups = max(0, atoi(arg.c_str() + 10));
+        } else if (arg.rfind("--args=", 0) == 0) {
+            arguments = arg.substr(7);
+        } else if (arg.rfind("--timeout=", 0) == 0) {
+            timeoutSeconds = max(0, atoi(arg.c_str() + 10));
+        } else if (arg.rfind("--out=", 0) == 0) {
+            outPath = arg.substr(6);
+        } else {
+            cerr << "Unknown option " << arg << endl;
+            return 1;
+        }
+    }
+    programs.erase(remove_if(programs.begin(), programs.end(), [](const Program& p) { return p.path.empty(); }),
+                   programs.end());
+
+    vector<int> sizes;
+    if (!parseCliqueSizes(cliqueSizes, sizes)) {
+        cerr << "Invalid clique sizes '" << cliqueSizes << "' (use a range like 2..6 or a list like 3,5,7)" << endl;
+        return 1;
+    }
+    vector<string> files = listDatasets(datasetDir);
+    if (files.empty()) {
+        cerr << "No *.txt datasets in " << datasetDir << endl;
+        return 1;
+    }
+    if (programs.empty()) {
+        cerr << "No programs to run" << endl;
+        return 1;
+    }
+
+    vector<string> datasets;
+    for (const string& file : files) {
+        datasets.push_back(file.substr(0, file.size() - 4));
+    }
+
+    cout << "Benchmarking " << programs.size() << " program(s) on " << files.size() << " dataset(s), "
+         << sizes.size() << " h value(s), " << repeats << " repeat(s) after " << warmups << " warm-up run(s)" << endl;
+
+    // Repeats are interleaved across programs so that drift in machine load
+    // affects both alike
+    vector<Measurement> measurements;
+    for (size_t d = 0; d < files.size(); d++) {
+        for (int w = 0; w < warmups; w++) {
+            for (const Program& program : programs) {
+                runOnce(program, datasetDir + "/" + files[d], sizes.front(), arguments, timeoutSeconds);
+            }
+        }
+        for (int h : sizes) {
+            size_t first = measurements.size();
+            for (const Program& program : programs) {
+                Measurement m;
+                m.program = program.name;
+                m.dataset = datasets[d];
+                m.h = h;
+                measurements.push_back(m);
+            }
+            for (int r = 0; r < repeats; r++) {
+                for (size_t p = 0; p < programs.size(); p++) {
+                    Measurement& m = measurements[first + p];
+                    RunResult run = runOnce(programs[p], datasetDir + "/" + files[d], h, arguments, timeoutSeconds);
+                    if (!run.ok) {
+                        m.failures++;
+                        continue;
+                    }
+                    m.vertices = run.vertices;
+                    m.density = run.density;
+                    for (int ph = 0; ph < PHASE_COUNT; ph++) {
+                        m.samples[ph].push_back(run.phase[ph]);
+                    }
+                }
+            }
+            for (size_t p = 0; p < programs.size(); p++) {
+                const Measurement& m = measurements[first + p];
+                char line[256];
+                snprintf(line, sizeof(line), "%-12s %-12s h=%-3d median %10.1f ms  density %12.4f  (%d failed)",
+                         m.program.c_str(), m.dataset.c_str(), h, median(m.samples[PHASE_COUNT - 1]), m.density,
+                         m.failures);
+                cout << line << endl;
+            }
+        }
+    }
+
+    ofstream out(outPath);
+    if (!out) {
+        cerr << "Cannot write " << outPath << endl;
+        return 1;
+    }
+    writeJson(out, programs, datasets, sizes, repeats, warmups, arguments, measurements);
+    cout << "Wrote " << outPath << endl;
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Persisted clique indexes shared by Algorithm1/algo1.cpp and
+// Algorithm4/CoreExact.cpp: the graph fingerprint that names them and the
+// on-disk layout. A file written by one program is read by the other.
+#ifndef COMMON_CLIQUE_CACHE_H
+#define COMMON_CLIQUE_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "snapshot.h"
+
+// 64-bit hash of a byte range, eight bytes per multiply-xorshift round with
+// a final avalanche. Used to recognise graph contents across runs, not as a
+// cryptographic checksum.
+inline uint64_t hashBytes(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed ^ (length * 0x9E3779B97F4A7C15ULL);
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Fingerprint of a CSR graph: its vertex count, row offsets and rows
+inline uint64_t graphFingerprint(int n, const IntArray& offsets, const IntArray& neighbors) {
+    uint64_t hash = hashBytes(&n, sizeof(n), 0);
+    hash = hashBytes(offsets.data(), sizeof(int) * offsets.size(), hash);
+    return hashBytes(neighbors.data(), sizeof(int) * neighbors.size(), hash);
+}
+
+// On-disk clique index of one graph and one h, named
+// <cache dir>/<graph fingerprint>-h<h>.cliques. After the header come the
+// h-clique degree of every vertex as 64-bit ints and then the (h-1)-cliques
+// as 32-bit ints, h-1 per clique.
+struct CliqueCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    uint64_t fingerprint;
+    int64_t vertexCount;
+    int64_t adjacencyEntries;
+    int64_t h;
+    int64_t hCliqueTotal;
+    int64_t storedCliques; // number of (h-1)-cliques
+};
+
+const char CLIQUE_CACHE_MAGIC[8] = {'C', 'D', 'S', 'C', 'L', 'I', 'Q', 'S'};
+const uint32_t CLIQUE_CACHE_VERSION = 1;
+
+// The graph and h a clique index belongs to
+struct CliqueCacheKey {
+    uint64_t fingerprint;
+    int64_t vertexCount;
+    int64_t adjacencyEntries;
+    int h;
+};
+
+// Contents of a mapped clique index
+struct CliqueCacheView {
+    int64_t hCliqueTotal = 0;
+    int64_t storedCliques = 0;
+    const char* degrees = nullptr; // vertexCount 64-bit ints, possibly unaligned
+    const int* cliques = nullptr;  // storedCliques * (h - 1) ints
+};
+
+inline std::string cliqueCacheFileName(const std::string& directory, const CliqueCacheKey& key) {
+    char name[64];
+    snprintf(name, sizeof(name), "/%016llx-h%d.cliques", (unsigned long long)key.fingerprint, key.h);
+    return directory + name;
+}
+
+// Map the clique index at path; false unless it exists, is complete and
+// was written for exactly this key
+inline bool mapCliqueCacheFile(const std::string& path, const CliqueCacheKey& key,
+                               std::shared_ptr<MappedFile>& file, CliqueCacheView& view) {
+    file = std::make_shared<MappedFile>();
+    if (!file->open(path) || file->size() < sizeof(CliqueCacheHeader)) return false;
+
+    CliqueCacheHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, CLIQUE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CLIQUE_CACHE_VERSION || header.headerBytes != sizeof(CliqueCacheHeader)) {
+        return false;
+    }
+    if (header.fingerprint != key.fingerprint || header.vertexCount != key.vertexCount ||
+        header.adjacencyEntries != key.adjacencyEntries || header.h != key.h || header.storedCliques < 0) {
+        return false;
+    }
+    size_t cells = (size_t)header.storedCliques * (key.h - 1);
+    if (file->size() != sizeof(CliqueCacheHeader) + sizeof(int64_t) * key.vertexCount + sizeof(int) * cells) {
+        return false;
+    }
+
+    view.hCliqueTotal = header.hCliqueTotal;
+    view.storedCliques = header.storedCliques;
+    view.degrees = file->data() + sizeof(CliqueCacheHeader);
+    view.cliques = reinterpret_cast<const int*>(view.degrees + sizeof(int64_t) * key.vertexCount);
+    return true;
+}
+
+// Write a clique index under a temporary name, then rename it into place
+inline bool writeCliqueCacheFile(const std::string& path, const CliqueCacheKey& key, int64_t hCliqueTotal,
+                                 const long long* degrees, const int* cliques, int64_t storedCliques) {
+    CliqueCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CLIQUE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = CLIQUE_CACHE_VERSION;
+    header.headerBytes = sizeof(CliqueCacheHeader);
+    header.fingerprint = key.fingerprint;
+    header.vertexCount = key.vertexCount;
+    header.adjacencyEntries = key.adjacencyEntries;
+    header.h = key.h;
+    header.hCliqueTotal = hCliqueTotal;
+    header.storedCliques = storedCliques;
+
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(degrees), sizeof(int64_t) * key.vertexCount);
+    out.write(reinterpret_cast<const char*>(cliques), sizeof(int) * storedCliques * (key.h - 1));
+    out.close();
+
+    if (!out || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+#endif
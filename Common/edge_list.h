@@ -0,0 +1,172 @@
+// Parallel edge-list parser shared by Algorithm1/algo1.cpp and
+// Algorithm4/CoreExact.cpp: both programs read datasets through
+// parseEdgeList, so they accept the same input and number vertices alike.
+#ifndef COMMON_EDGE_LIST_H
+#define COMMON_EDGE_LIST_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "parallel.h"
+
+// Sort by sorting equal slices in parallel and then merging neighbouring
+// slices pairwise, one parallel round per doubling of the slice width
+inline void parallelSort(std::vector<int>& values, int threads) {
+    size_t count = values.size();
+    int parts = (int)std::max<size_t>(1, std::min<size_t>(threads, count / 65536));
+    std::vector<size_t> bound(parts + 1);
+    for (int i = 0; i <= parts; i++) {
+        bound[i] = count * i / parts;
+    }
+
+    runTasks(parts, [&](int i) {
+        std::sort(values.begin() + bound[i], values.begin() + bound[i + 1]);
+    });
+    for (int width = 1; width < parts; width *= 2) {
+        runTasks((parts + 2 * width - 1) / (2 * width), [&](int j) {
+            int lo = j * 2 * width;
+            int mid = std::min(lo + width, parts);
+            int hi = std::min(lo + 2 * width, parts);
+            if (mid < hi) {
+                std::inplace_merge(values.begin() + bound[lo], values.begin() + bound[mid], values.begin() + bound[hi]);
+            }
+        });
+    }
+}
+
+// Parse one integer starting at p, skipping spaces and tabs but never a
+// line break. Returns false, leaving p on the offending character, when
+// the line ends first or the text is not a number.
+inline bool scanInteger(const char*& p, const char* end, long long& value) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    if (p == end) return false;
+
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+') p++;
+    if (p == end || *p < '0' || *p > '9') return false;
+
+    long long result = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (result < (1LL << 40)) result = result * 10 + (*p - '0');
+        p++;
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+// Edge list read from text. Vertex ids are compacted to 0..n-1 in the
+// order of their original values; originalId maps them back.
+struct EdgeList {
+    long long declaredVertices = 0; // "n m" header line
+    long long declaredEdges = 0;
+    std::vector<std::pair<int, int>> edges;
+    std::vector<int> originalId;
+    long long malformedLines = 0;
+    long long selfLoops = 0;
+};
+
+// Parse "n m" followed by one edge per line, "u v" or "u v w" (a third
+// column such as an edge sign is ignored). The text is split into chunks at
+// line breaks and scanned by up to `threads` threads; ids are then
+// compacted by a parallel sort/unique and a binary search per endpoint.
+inline EdgeList parseEdgeList(const char* text, size_t length, int threads) {
+    EdgeList result;
+    const char* end = text + length;
+    const char* p = text;
+
+    // The header is the first non-blank line
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    long long value;
+    if (scanInteger(p, end, value)) result.declaredVertices = value;
+    if (scanInteger(p, end, value)) result.declaredEdges = value;
+    while (p < end && *p != '\n') p++;
+
+    // Chunks of at least 1 MiB, each starting at the beginning of a line
+    size_t body = end - p;
+    int chunks = (int)std::max<size_t>(1, std::min<size_t>(threads, body >> 20));
+    std::vector<const char*> chunkStart(chunks + 1);
+    chunkStart[0] = p;
+    chunkStart[chunks] = end;
+    for (int i = 1; i < chunks; i++) {
+        const char* cut = p + body * i / chunks;
+        while (cut < end && *cut != '\n') cut++;
+        chunkStart[i] = std::max(cut, chunkStart[i - 1]);
+    }
+
+    std::vector<std::vector<std::pair<int, int>>> chunkEdges(chunks);
+    std::vector<long long> chunkMalformed(chunks, 0), chunkLoops(chunks, 0);
+    runTasks(chunks, [&](int c) {
+        std::vector<std::pair<int, int>>& out = chunkEdges[c];
+        out.reserve((chunkStart[c + 1] - chunkStart[c]) / 8);
+        const char* q = chunkStart[c];
+        const char* stop = chunkStart[c + 1];
+
+        while (q < stop) {
+            if (*q == '\n') {
+                q++;
+                continue;
+            }
+            long long u, v, extra;
+            const char* lineStart = q;
+            bool ok = scanInteger(q, stop, u) && scanInteger(q, stop, v);
+            if (ok) scanInteger(q, stop, extra);
+            while (q < stop && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+            ok = ok && (q == stop || *q == '\n');
+            ok = ok && u >= std::numeric_limits<int>::min() && u <= std::numeric_limits<int>::max();
+            ok = ok && v >= std::numeric_limits<int>::min() && v <= std::numeric_limits<int>::max();
+
+            if (ok && u != v) {
+                out.push_back({(int)u, (int)v});
+            } else if (ok) {
+                chunkLoops[c]++;
+            } else {
+                // Tolerate blank lines; anything else is reported
+                const char* r = lineStart;
+                while (r < stop && (*r == ' ' || *r == '\t' || *r == '\r')) r++;
+                if (r < stop && *r != '\n') chunkMalformed[c]++;
+            }
+            while (q < stop && *q != '\n') q++;
+        }
+    });
+
+    // Concatenate the chunk outputs in file order
+    std::vector<size_t> chunkOffset(chunks + 1, 0);
+    for (int c = 0; c < chunks; c++) {
+        chunkOffset[c + 1] = chunkOffset[c] + chunkEdges[c].size();
+        result.malformedLines += chunkMalformed[c];
+        result.selfLoops += chunkLoops[c];
+    }
+    result.edges.resize(chunkOffset[chunks]);
+    runTasks(chunks, [&](int c) {
+        std::copy(chunkEdges[c].begin(), chunkEdges[c].end(), result.edges.begin() + chunkOffset[c]);
+        std::vector<std::pair<int, int>>().swap(chunkEdges[c]);
+    });
+
+    // Compact ids: sorted distinct endpoint values become 0..n-1
+    size_t edgeCount = result.edges.size();
+    std::vector<int>& ids = result.originalId;
+    ids.resize(2 * edgeCount);
+    for (size_t i = 0; i < edgeCount; i++) {
+        ids[2 * i] = result.edges[i].first;
+        ids[2 * i + 1] = result.edges[i].second;
+    }
+    parallelSort(ids, threads);
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    ids.shrink_to_fit();
+
+    int parts = (int)std::max<size_t>(1, std::min<size_t>(threads, edgeCount / 65536));
+    runTasks(parts, [&](int i) {
+        size_t first = edgeCount * i / parts, last = edgeCount * (i + 1) / parts;
+        for (size_t e = first; e < last; e++) {
+            auto& edge = result.edges[e];
+            edge.first = std::lower_bound(ids.begin(), ids.end(), edge.first) - ids.begin();
+            edge.second = std::lower_bound(ids.begin(), ids.end(), edge.second) - ids.begin();
+        }
+    });
+
+    return result;
+}
+
+#endif
@@ -0,0 +1,243 @@
+// Sorted-set intersection kernels (scalar, galloping, SSE, AVX2, AVX-512)
+// with runtime dispatch, shared by Algorithm1/algo1.cpp and
+// Algorithm4/CoreExact.cpp. --simd=<kind> in either program sets
+// intersectKernels through pickIntersectKernels.
+#ifndef COMMON_INTERSECT_H
+#define COMMON_INTERSECT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Sorted-set intersection kernels. Both inputs are strictly increasing id
+// lists. The vector versions compare a block of one list against every
+// rotation of a block of the other, write the matching elements of the
+// first block, and then advance whichever block has the smaller last
+// element. Every pair of blocks is compared at most once, so each common
+// element is found exactly once and the output stays sorted.
+
+// Extra ints the output of intersectInto must have beyond min(na, nb): the
+// vector kernels store whole registers
+const int INTERSECT_PADDING = 16;
+
+// Branch-free merge; with Store == false only the count is produced
+template <bool Store>
+int intersectScalar(const int* a, int na, const int* b, int nb, int* out) {
+    int i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        int x = a[i], y = b[j];
+        if (Store) out[k] = x;
+        k += (x == y);
+        i += (x <= y);
+        j += (y <= x);
+    }
+    return k;
+}
+
+// For a much shorter than b: binary-search each element of a in what is
+// left of b
+template <bool Store>
+int intersectGallop(const int* a, int na, const int* b, int nb, int* out) {
+    const int* from = b;
+    const int* end = b + nb;
+    int k = 0;
+    for (int i = 0; i < na && from < end; i++) {
+        from = std::lower_bound(from, end, a[i]);
+        if (from != end && *from == a[i]) {
+            if (Store) out[k] = a[i];
+            k++;
+        }
+    }
+    return k;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Shuffle controls that pack the lanes selected by a mask to the front
+struct IntersectTables {
+    uint8_t sse[16][16];
+    int avx2[256][8];
+
+    IntersectTables() {
+        memset(sse, 0, sizeof(sse));
+        memset(avx2, 0, sizeof(avx2));
+        for (int mask = 0; mask < 16; mask++) {
+            int k = 0;
+            for (int lane = 0; lane < 4; lane++) {
+                if (!(mask >> lane & 1)) continue;
+                for (int byte = 0; byte < 4; byte++) {
+                    sse[mask][4 * k + byte] = 4 * lane + byte;
+                }
+                k++;
+            }
+        }
+        for (int mask = 0; mask < 256; mask++) {
+            int k = 0;
+            for (int lane = 0; lane < 8; lane++) {
+                if (mask >> lane & 1) avx2[mask][k++] = lane;
+            }
+        }
+    }
+};
+
+inline const IntersectTables INTERSECT_TABLES;
+
+template <bool Store>
+__attribute__((target("sse4.2,popcnt")))
+int intersectSSE(const int* a, int na, const int* b, int nb, int* out) {
+    int i = 0, j = 0, k = 0;
+    while (i + 4 <= na && j + 4 <= nb) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+        __m128i eq0 = _mm_cmpeq_epi32(va, vb);
+        __m128i eq1 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)));
+        __m128i eq2 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2)));
+        __m128i eq3 = _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)));
+        __m128i eq = _mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (Store) {
+            __m128i pack = _mm_loadu_si128(reinterpret_cast<const __m128i*>(INTERSECT_TABLES.sse[mask]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), _mm_shuffle_epi8(va, pack));
+        }
+        k += _mm_popcnt_u32(mask);
+        int lastA = a[i + 3], lastB = b[j + 3];
+        i += (lastA <= lastB) * 4;
+        j += (lastB <= lastA) * 4;
+    }
+    return k + intersectScalar<Store>(a + i, na - i, b + j, nb - j, out + k);
+}
+
+template <bool Store>
+__attribute__((target("avx2,popcnt")))
+int intersectAVX2(const int* a, int na, const int* b, int nb, int* out) {
+    const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+    int i = 0, j = 0, k = 0;
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+        __m256i eq = _mm256_cmpeq_epi32(va, vb);
+        for (int r = 1; r < 8; r++) {
+            vb = _mm256_permutevar8x32_epi32(vb, rotate);
+            eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, vb));
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (Store) {
+            __m256i pack = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(INTERSECT_TABLES.avx2[mask]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + k), _mm256_permutevar8x32_epi32(va, pack));
+        }
+        k += _mm_popcnt_u32(mask);
+        int lastA = a[i + 7], lastB = b[j + 7];
+        i += (lastA <= lastB) * 8;
+        j += (lastB <= lastA) * 8;
+    }
+    return k + intersectSSE<Store>(a + i, na - i, b + j, nb - j, out + k);
+}
+
+template <bool Store>
+__attribute__((target("avx512f,avx2,popcnt")))
+int intersectAVX512(const int* a, int na, const int* b, int nb, int* out) {
+    const __m512i rotate = _mm512_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 0);
+    int i = 0, j = 0, k = 0;
+    while (i + 16 <= na && j + 16 <= nb) {
+        __m512i va = _mm512_loadu_si512(a + i);
+        __m512i vb = _mm512_loadu_si512(b + j);
+        __mmask16 mask = _mm512_cmpeq_epi32_mask(va, vb);
+        for (int r = 1; r < 16; r++) {
+            vb = _mm512_maskz_permutexvar_epi32(0xFFFF, rotate, vb);
+            mask |= _mm512_cmpeq_epi32_mask(va, vb);
+        }
+        if (Store) _mm512_mask_compressstoreu_epi32(out + k, mask, va);
+        k += _mm_popcnt_u32(mask);
+        int lastA = a[i + 15], lastB = b[j + 15];
+        i += (lastA <= lastB) * 16;
+        j += (lastB <= lastA) * 16;
+    }
+    return k + intersectAVX2<Store>(a + i, na - i, b + j, nb - j, out + k);
+}
+#endif
+
+// Set bits in a 64-bit word; the portable fallback avoids a libgcc call
+// when the build does not target POPCNT
+inline int popCount64(uint64_t x) {
+#ifdef __POPCNT__
+    return __builtin_popcountll(x);
+#else
+    x -= (x >> 1) & 0x5555555555555555ULL;
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// The kernel pair in use, chosen once from what the CPU supports
+struct IntersectKernels {
+    const char* name;
+    int (*into)(const int*, int, const int*, int, int*);
+    int (*count)(const int*, int, const int*, int, int*);
+};
+
+// Kernels by name; "auto" picks the widest the CPU runs. Returns false for
+// an unknown name or one the CPU cannot run.
+inline bool pickIntersectKernels(const std::string& name, IntersectKernels& kernels) {
+    IntersectKernels scalar = {"scalar", intersectScalar<true>, intersectScalar<false>};
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    IntersectKernels available[] = {
+        {"avx512", intersectAVX512<true>, intersectAVX512<false>},
+        {"avx2", intersectAVX2<true>, intersectAVX2<false>},
+        {"sse", intersectSSE<true>, intersectSSE<false>},
+    };
+    bool supported[] = {
+        __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"),
+        __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"),
+        __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"),
+    };
+    for (int i = 0; i < 3; i++) {
+        if (!supported[i]) continue;
+        if (name == "auto" || name == available[i].name) {
+            kernels = available[i];
+            return true;
+        }
+    }
+#endif
+    if (name != "auto" && name != "scalar") return false;
+    kernels = scalar;
+    return true;
+}
+
+inline IntersectKernels pickDefaultIntersectKernels() {
+    IntersectKernels kernels;
+    pickIntersectKernels("auto", kernels);
+    return kernels;
+}
+
+inline IntersectKernels intersectKernels = pickDefaultIntersectKernels();
+
+// Write a ∩ b to out in increasing order and return its size. out needs
+// room for min(na, nb) + INTERSECT_PADDING ints.
+inline int intersectInto(const int* a, int na, const int* b, int nb, int* out) {
+    if (na > nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (na == 0) return 0;
+    if ((long long)na * 32 < nb) return intersectGallop<true>(a, na, b, nb, out);
+    return intersectKernels.into(a, na, b, nb, out);
+}
+
+// |a ∩ b| without writing anything
+inline int intersectCount(const int* a, int na, const int* b, int nb) {
+    if (na > nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (na == 0) return 0;
+    if ((long long)na * 32 < nb) return intersectGallop<false>(a, na, b, nb, nullptr);
+    return intersectKernels.count(a, na, b, nb, nullptr);
+}
+
+#endif
@@ -0,0 +1,612 @@
+// Max-flow engines shared by Algorithm1/algo1.cpp and Algorithm4/CoreExact.cpp:
+// the flat-array flow network, Dinic's algorithm, highest-label
+// push-relabel with parametric warm starts, and the MaxFlowSolver interface
+// that --flow=<name> selects from.
+#ifndef COMMON_MAX_FLOW_H
+#define COMMON_MAX_FLOW_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include "metrics.h"
+
+// Arc capacity type; INF_CAPACITY marks arcs that can never be cut
+typedef long long Capacity;
+const Capacity INF_CAPACITY = std::numeric_limits<Capacity>::max() / 4;
+
+// Distinct stamp for every FlowNetwork::build(), shared by all threads
+inline std::atomic<uint64_t> flowNetworkBuilds{0};
+
+// Sparse flow network in flat arrays. Arcs are added in pairs so that the
+// reverse of arc e is e ^ 1; build() then groups arc ids by tail node so
+// each node's arcs can be scanned contiguously.
+struct FlowNetwork {
+    int nodeCount;
+    uint64_t generation = 0;   // Set by build(); tells solvers apart networks that share an address
+    std::vector<int> head;          // Node each arc points to
+    std::vector<Capacity> capacity; // Original capacity (0 for reverse arcs)
+    std::vector<Capacity> residual; // Remaining capacity in the residual graph
+    std::vector<int> arcStart;      // arcList[arcStart[u] .. arcStart[u+1]) are the arcs leaving u
+    std::vector<int> arcList;
+
+    explicit FlowNetwork(int nodes) : nodeCount(nodes) {}
+
+    // Empty the network for reuse with a new node count. The arc arrays keep
+    // their memory, so one FlowNetwork can serve as the arena for a whole run.
+    void recycle(int nodes) {
+        nodeCount = nodes;
+        head.clear();
+        capacity.clear();
+        residual.clear();
+        arcList.clear();
+    }
+
+    // Size the arc arrays for the given number of arcs (reverse arcs not
+    // counted) so that building the network never reallocates
+    void reserveArcs(size_t arcs) {
+        head.reserve(2 * arcs);
+        capacity.reserve(2 * arcs);
+        residual.reserve(2 * arcs);
+        arcList.reserve(2 * arcs);
+    }
+
+    // Add arc u -> v with the given capacity and its zero-capacity reverse
+    int addArc(int u, int v, Capacity cap) {
+        int e = head.size();
+        head.push_back(v);
+        capacity.push_back(cap);
+        head.push_back(u);
+        capacity.push_back(0);
+        return e;
+    }
+
+    int tailOf(int e) const {
+        return head[e ^ 1];
+    }
+
+    // Remove all flow, restoring every residual capacity
+    void resetFlow() {
+        residual = capacity;
+    }
+
+    // Group arcs by tail node and reset all flow to zero
+    void build() {
+        arcStart.assign(nodeCount + 1, 0);
+        for (size_t e = 0; e < head.size(); e++) {
+            arcStart[tailOf(e) + 1]++;
+        }
+        for (int u = 0; u < nodeCount; u++) {
+            arcStart[u + 1] += arcStart[u];
+        }
+
+        std::vector<int> cursor(arcStart.begin(), arcStart.end() - 1);
+        arcList.resize(head.size());
+        for (size_t e = 0; e < head.size(); e++) {
+            arcList[cursor[tailOf(e)]++] = e;
+        }
+        generation = ++flowNetworkBuilds;
+        resetFlow();
+    }
+};
+
+// Per-node scratch arrays of Dinic's algorithm. Keeping one alive across
+// solves of the same network avoids reallocating them on every call.
+struct DinicWorkspace {
+    std::vector<int> level;
+    std::vector<int> current;
+    std::vector<int> bfsQueue;
+    std::vector<int> path;
+    std::vector<char> visited;
+
+    void fit(int nodes) {
+        level.resize(nodes);
+        current.resize(nodes);
+        bfsQueue.resize(nodes);
+        visited.resize(nodes);
+    }
+};
+
+// Dinic's algorithm for maximum flow on a built FlowNetwork. The blocking
+// flow is found with an explicit path stack and per-node current-arc
+// pointers. minCut receives the nodes reachable from s in the residual graph.
+inline Capacity dinicMaxFlow(FlowNetwork& net, int s, int t, std::vector<int>& minCut, DinicWorkspace& work, std::ostream& log = std::cout) {
+    int n = net.nodeCount;
+    if (s < 0 || s >= n || t < 0 || t >= n) {
+        std::cerr << "Invalid source or sink in flow network" << std::endl;
+        return 0;
+    }
+
+    work.fit(n);
+    std::vector<int>& level = work.level;
+    std::vector<int>& current = work.current;
+    std::vector<int>& bfsQueue = work.bfsQueue;
+    std::vector<int>& path = work.path;
+
+    // BFS to create level graph
+    auto bfs = [&]() -> bool {
+        std::fill(level.begin(), level.end(), -1);
+        level[s] = 0;
+
+        int qHead = 0, qTail = 0;
+        bfsQueue[qTail++] = s;
+
+        while (qHead < qTail) {
+            int u = bfsQueue[qHead++];
+            for (int i = net.arcStart[u]; i < net.arcStart[u + 1]; i++) {
+                int e = net.arcList[i];
+                int v = net.head[e];
+                if (level[v] < 0 && net.residual[e] > 0) {
+                    level[v] = level[u] + 1;
+                    bfsQueue[qTail++] = v;
+                }
+            }
+        }
+
+        return level[t] >= 0;
+    };
+
+    // Augment along level-increasing paths until no s-t path is left
+    long long augmentations = 0;
+    auto blockingFlow = [&]() -> Capacity {
+        Capacity pushed = 0;
+        path.clear();
+        int u = s;
+
+        while (true) {
+            if (u == t) {
+                Capacity bottleneck = INF_CAPACITY;
+                for (int e : path) {
+                    bottleneck = std::min(bottleneck, net.residual[e]);
+                }
+
+                // Apply the augmentation and retreat to the first saturated arc
+                size_t firstSaturated = path.size();
+                for (size_t i = 0; i < path.size(); i++) {
+                    int e = path[i];
+                    net.residual[e] -= bottleneck;
+                    net.residual[e ^ 1] += bottleneck;
+                    if (net.residual[e] == 0 && firstSaturated == path.size()) {
+                        firstSaturated = i;
+                    }
+                }
+                pushed += bottleneck;
+                augmentations++;
+                u = net.tailOf(path[firstSaturated]);
+                path.resize(firstSaturated);
+                continue;
+            }
+
+            // Advance along the current arc of u
+            int& i = current[u];
+            while (i < net.arcStart[u + 1]) {
+                int e = net.arcList[i];
+                if (net.residual[e] > 0 && level[net.head[e]] == level[u] + 1) break;
+                i++;
+            }
+
+            if (i < net.arcStart[u + 1]) {
+                int e = net.arcList[i];
+                path.push_back(e);
+                u = net.head[e];
+            } else {
+                // Dead end: drop u from the level graph and retreat
+                level[u] = -1;
+                if (path.empty()) break;
+                int e = path.back();
+                path.pop_back();
+                u = net.tailOf(e);
+                current[u]++;
+            }
+        }
+
+        return pushed;
+    };
+
+    Capacity maxFlow = 0;
+    int dinicIterations = 0;
+    log << "Running Dinic's max-flow algorithm: " << std::flush;
+
+    // Main Dinic's algorithm loop
+    while (bfs()) {
+        dinicIterations++;
+        if (!quietMode && dinicIterations % 10 == 0) {
+            log << "." << std::flush;
+        }
+
+        std::copy(net.arcStart.begin(), net.arcStart.end() - 1, current.begin());
+        maxFlow += blockingFlow();
+    }
+
+    log << " Done!" << std::endl;
+    metrics.bfsPhases += dinicIterations + 1;
+    metrics.augmentingPaths += augmentations;
+
+    // Find min-cut: nodes still reachable from s
+    std::vector<char>& visited = work.visited;
+    std::fill(visited.begin(), visited.end(), 0);
+    int qHead = 0, qTail = 0;
+    bfsQueue[qTail++] = s;
+    visited[s] = true;
+
+    while (qHead < qTail) {
+        int u = bfsQueue[qHead++];
+        for (int i = net.arcStart[u]; i < net.arcStart[u + 1]; i++) {
+            int e = net.arcList[i];
+            int v = net.head[e];
+            if (net.residual[e] > 0 && !visited[v]) {
+                visited[v] = true;
+                bfsQueue[qTail++] = v;
+            }
+        }
+    }
+
+    minCut.clear();
+    for (int i = 0; i < n; i++) {
+        if (visited[i]) {
+            minCut.push_back(i);
+        }
+    }
+
+    return maxFlow;
+}
+
+inline Capacity dinicMaxFlow(FlowNetwork& net, int s, int t, std::vector<int>& minCut) {
+    DinicWorkspace work;
+    return dinicMaxFlow(net, s, t, minCut, work);
+}
+
+// Highest-label push-relabel with global relabeling and the gap heuristic.
+// Phase one builds a maximum preflow, which already determines the minimum
+// cut; phase two, which returns leftover excess to the source to obtain a
+// proper flow, runs only when requested.
+class PushRelabel {
+private:
+    FlowNetwork& net;
+    int n;
+    std::vector<Capacity> excess;
+    std::vector<int> height;
+    std::vector<int> current;
+    std::vector<int> activeFirst, activeNext;          // Active nodes bucketed by height
+    std::vector<int> idleFirst, idleNext, idlePrev;    // Inactive nodes bucketed by height
+    std::vector<int> bfsQueue;
+    int maxActive = -1, maxHeight = -1;
+    long long workSinceUpdate = 0;
+
+    void addActive(int u) {
+        activeNext[u] = activeFirst[height[u]];
+        activeFirst[height[u]] = u;
+        maxActive = std::max(maxActive, height[u]);
+        maxHeight = std::max(maxHeight, height[u]);
+    }
+
+    void addIdle(int u) {
+        int h = height[u];
+        idlePrev[u] = -1;
+        idleNext[u] = idleFirst[h];
+        if (idleFirst[h] >= 0) idlePrev[idleFirst[h]] = u;
+        idleFirst[h] = u;
+        maxHeight = std::max(maxHeight, h);
+    }
+
+    void removeIdle(int u) {
+        int h = height[u];
+        if (idlePrev[u] >= 0) idleNext[idlePrev[u]] = idleNext[u];
+        else idleFirst[h] = idleNext[u];
+        if (idleNext[u] >= 0) idlePrev[idleNext[u]] = idlePrev[u];
+    }
+
+    // Exact distance labels towards target by reverse BFS in the residual
+    // graph; nodes that cannot reach it are lifted to n and leave the phase
+    void globalRelabel(int target, int other) {
+        std::fill(height.begin(), height.end(), n);
+        std::fill(activeFirst.begin(), activeFirst.end(), -1);
+        std::fill(idleFirst.begin(), idleFirst.end(), -1);
+        maxActive = maxHeight = -1;
+        workSinceUpdate = 0;
+
+        int qHead = 0, qTail = 0;
+        height[target] = 0;
+        bfsQueue[qTail++] = target;
+        while (qHead < qTail) {
+            int v = bfsQueue[qHead++];
+            for (int i = net.arcStart[v]; i < net.arcStart[v + 1]; i++) {
+                int e = net.arcList[i];
+                int u = net.head[e];
+                if (height[u] == n && u != other && net.residual[e ^ 1] > 0) {
+                    height[u] = height[v] + 1;
+                    bfsQueue[qTail++] = u;
+                }
+            }
+        }
+
+        for (int i = 1; i < qTail; i++) {
+            int u = bfsQueue[i];
+            current[u] = net.arcStart[u];
+            if (excess[u] > 0) addActive(u);
+            else addIdle(u);
+        }
+    }
+
+    // Lift every node above an emptied height out of the phase
+    void gapRelabel(int emptied) {
+        for (int h = emptied + 1; h <= maxHeight; h++) {
+            for (int u = idleFirst[h]; u >= 0; u = idleNext[u]) {
+                height[u] = n;
+            }
+            idleFirst[h] = -1;
+        }
+        maxHeight = emptied - 1;
+    }
+
+    // Push excess out of u along admissible arcs, relabeling when stuck
+    void discharge(int u, int target) {
+        while (excess[u] > 0) {
+            int end = net.arcStart[u + 1];
+            int& i = current[u];
+            for (; i < end; i++) {
+                int e = net.arcList[i];
+                int v = net.head[e];
+                if (net.residual[e] == 0 || height[u] != height[v] + 1) continue;
+
+                Capacity delta = std::min(excess[u], net.residual[e]);
+                net.residual[e] -= delta;
+                net.residual[e ^ 1] += delta;
+                excess[u] -= delta;
+                if (v != target && excess[v] == 0) {
+                    removeIdle(v);
+                    addActive(v);
+                }
+                excess[v] += delta;
+                pushes++;
+                if (excess[u] == 0) break;
+            }
+            if (excess[u] == 0) break;
+
+            // Relabel: one above the lowest residual neighbour
+            int oldHeight = height[u];
+            int newHeight = n;
+            for (int k = net.arcStart[u]; k < end; k++) {
+                int e = net.arcList[k];
+                if (net.residual[e] > 0) newHeight = std::min(newHeight, height[net.head[e]] + 1);
+            }
+            workSinceUpdate += 12 + (end - net.arcStart[u]);
+            relabels++;
+
+            if (activeFirst[oldHeight] < 0 && idleFirst[oldHeight] < 0) {
+                // u was the last node at its height: everything above is cut off
+                gapRelabel(oldHeight);
+                height[u] = n;
+                return;
+            }
+            height[u] = newHeight;
+            current[u] = net.arcStart[u];
+            if (newHeight >= n) return;
+            maxHeight = std::max(maxHeight, newHeight);
+        }
+    }
+
+    // Discharge active nodes from the highest label down until none is left
+    void runPhase(int target, int other) {
+        globalRelabel(target, other);
+        long long updateThreshold = 6LL * n + (long long)net.head.size() / 2;
+
+        while (maxActive >= 0) {
+            int u = activeFirst[maxActive];
+            if (u < 0) {
+                maxActive--;
+                continue;
+            }
+            activeFirst[maxActive] = activeNext[u];
+
+            discharge(u, target);
+            if (height[u] < n) {
+                if (excess[u] > 0) addActive(u);
+                else addIdle(u);
+            }
+
+            if (workSinceUpdate > updateThreshold) {
+                globalRelabel(target, other);
+            }
+        }
+    }
+
+public:
+    long long pushes = 0;
+    long long relabels = 0;
+
+    explicit PushRelabel(FlowNetwork& network) : net(network) {
+        reset();
+    }
+
+    // Forget the preflow and all labels so the next solve() starts from
+    // zero flow; the arrays keep their memory
+    void reset() {
+        n = net.nodeCount;
+        pushes = relabels = 0;
+        excess.assign(n, 0);
+        height.assign(n, n);
+        current.assign(n, 0);
+        activeFirst.assign(n + 1, -1);
+        activeNext.assign(n, -1);
+        idleFirst.assign(n + 1, -1);
+        idleNext.assign(n, -1);
+        idlePrev.assign(n, -1);
+        bfsQueue.assign(n, 0);
+    }
+
+    // Run phase one from the current preflow: first saturate whatever
+    // residual capacity the source arcs have, then discharge. Returns the cut
+    // capacity; sourceSide receives the nodes that can no longer reach t.
+    // Calling it again after changeCapacity() continues from the previous
+    // preflow instead of starting over (parametric re-solve).
+    Capacity solve(int s, int t, std::vector<int>& sourceSide, bool recoverFlow) {
+        for (int i = net.arcStart[s]; i < net.arcStart[s + 1]; i++) {
+            int e = net.arcList[i];
+            Capacity delta = net.residual[e];
+            if (delta == 0) continue;
+            net.residual[e] = 0;
+            net.residual[e ^ 1] += delta;
+            excess[net.head[e]] += delta;
+        }
+        excess[s] = 0;
+
+        runPhase(t, s);
+        Capacity cutValue = excess[t];
+
+        // After the final global relabel height[u] == n exactly when u is cut off from t
+        globalRelabel(t, s);
+        sourceSide.clear();
+        for (int u = 0; u < n; u++) {
+            if (height[u] >= n) sourceSide.push_back(u);
+        }
+
+        if (recoverFlow) {
+            runPhase(s, t);
+        }
+        return cutValue;
+    }
+
+    // Set the capacity of an arc into t while keeping a valid preflow: flow
+    // above the new capacity is pulled back and left as excess at the tail.
+    // Labels are recomputed by the next solve().
+    void changeSinkCapacity(int e, Capacity newCapacity) {
+        Capacity flow = net.capacity[e] - net.residual[e];
+        net.capacity[e] = newCapacity;
+        if (flow <= newCapacity) {
+            net.residual[e] = newCapacity - flow;
+            return;
+        }
+        Capacity overflow = flow - newCapacity;
+        net.residual[e] = 0;
+        net.residual[e ^ 1] -= overflow;
+        excess[net.tailOf(e)] += overflow;
+        excess[net.head[e]] -= overflow;
+    }
+};
+
+// Common interface of the max-flow engines used by the density search. Each
+// computes a minimum s-t cut of a built network and reports its source side.
+class MaxFlowSolver {
+protected:
+    std::ostream* log = &std::cout; // Progress messages
+
+public:
+    virtual ~MaxFlowSolver() {}
+    virtual const char* name() const = 0;
+
+    // A solver of the same kind with no state, for use on another thread
+    virtual std::unique_ptr<MaxFlowSolver> clone() const = 0;
+
+    void setLog(std::ostream& out) {
+        log = &out;
+    }
+
+    // Minimum cut of the network starting from zero flow
+    virtual Capacity minCut(FlowNetwork& net, int s, int t, std::vector<int>& sourceSide) = 0;
+
+    // Change the capacity of an arc into the sink between two solves
+    virtual void setSinkCapacity(FlowNetwork& net, int e, Capacity c) {
+        net.capacity[e] = c;
+    }
+
+    // Minimum cut after setSinkCapacity calls. Engines without a warm start
+    // simply solve again from zero flow.
+    virtual Capacity resolve(FlowNetwork& net, int s, int t, std::vector<int>& sourceSide) {
+        return minCut(net, s, t, sourceSide);
+    }
+};
+
+class DinicSolver : public MaxFlowSolver {
+private:
+    DinicWorkspace work;
+
+public:
+    const char* name() const override { return "dinic"; }
+
+    std::unique_ptr<MaxFlowSolver> clone() const override {
+        return std::unique_ptr<MaxFlowSolver>(new DinicSolver());
+    }
+
+    Capacity minCut(FlowNetwork& net, int s, int t, std::vector<int>& sourceSide) override {
+        net.resetFlow();
+        return dinicMaxFlow(net, s, t, sourceSide, work, *log);
+    }
+};
+
+// Push-relabel behind the solver interface. In parametric mode the engine,
+// its preflow and its excesses survive between solves, in the spirit of
+// Gallo-Grigoriadis-Tarjan: when only sink capacities move, the next solve
+// continues from the previous maximum preflow instead of from zero.
+class PushRelabelSolver : public MaxFlowSolver {
+private:
+    bool cutOnly;    // Skip phase two; the residual then holds a preflow
+    bool parametric; // Keep the preflow across resolve() calls
+    std::unique_ptr<PushRelabel> engine;
+    uint64_t engineGeneration = 0; // Build of the network the engine's state belongs to
+
+    Capacity run(int s, int t, std::vector<int>& sourceSide) {
+        long long pushesBefore = engine->pushes, relabelsBefore = engine->relabels;
+        Capacity value = engine->solve(s, t, sourceSide, !cutOnly);
+        metrics.pushes += engine->pushes - pushesBefore;
+        metrics.relabels += engine->relabels - relabelsBefore;
+        *log << "Done! (" << engine->pushes << " pushes, " << engine->relabels << " relabels)" << std::endl;
+        return value;
+    }
+
+public:
+    PushRelabelSolver(bool onlyCut, bool warmStart) : cutOnly(onlyCut), parametric(warmStart) {}
+
+    const char* name() const override {
+        if (!cutOnly) return "push-relabel-flow";
+        return parametric ? "push-relabel (parametric)" : "push-relabel";
+    }
+
+    std::unique_ptr<MaxFlowSolver> clone() const override {
+        return std::unique_ptr<MaxFlowSolver>(new PushRelabelSolver(cutOnly, parametric));
+    }
+
+    Capacity minCut(FlowNetwork& net, int s, int t, std::vector<int>& sourceSide) override {
+        *log << "Running push-relabel max-flow algorithm... " << std::flush;
+        net.resetFlow();
+        if (engine && engineGeneration == net.generation) {
+            engine->reset();
+        } else {
+            engine.reset(new PushRelabel(net));
+            engineGeneration = net.generation;
+        }
+        return run(s, t, sourceSide);
+    }
+
+    void setSinkCapacity(FlowNetwork& net, int e, Capacity c) override {
+        if (parametric && engine && engineGeneration == net.generation) {
+            engine->changeSinkCapacity(e, c);
+        } else {
+            net.capacity[e] = c;
+        }
+    }
+
+    Capacity resolve(FlowNetwork& net, int s, int t, std::vector<int>& sourceSide) override {
+        if (!parametric || !engine || engineGeneration != net.generation) {
+            return minCut(net, s, t, sourceSide);
+        }
+        *log << "Re-solving from previous preflow... " << std::flush;
+        return run(s, t, sourceSide);
+    }
+};
+
+// Solver selected by --flow=<name>; returns nullptr for an unknown name.
+// warmStart enables parametric re-solving where the engine supports it.
+inline std::unique_ptr<MaxFlowSolver> makeMaxFlowSolver(const std::string& name, bool warmStart) {
+    if (name == "dinic") return std::unique_ptr<MaxFlowSolver>(new DinicSolver());
+    if (name == "push-relabel" || name == "pr") return std::unique_ptr<MaxFlowSolver>(new PushRelabelSolver(true, warmStart));
+    if (name == "push-relabel-flow") return std::unique_ptr<MaxFlowSolver>(new PushRelabelSolver(false, warmStart));
+    return nullptr;
+}
+
+#endif
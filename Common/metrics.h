@@ -0,0 +1,213 @@
+// Run metrics shared by Algorithm1/algo1.cpp and Algorithm4/CoreExact.cpp:
+// phase timers, work counters, --perf phase totals, the --metrics JSON that
+// Benchmark/benchmark.cpp reads, and the --quiet progress stream. Both
+// programs fill the same fields under the same phase names.
+#ifndef COMMON_METRICS_H
+#define COMMON_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/resource.h>
+#include "perf_counters.h"
+
+// Run-wide metrics: phase timers in microseconds and event counters,
+// written as JSON by --metrics=<file>. Hot loops count into locals and add
+// them here once per call, so the shared atomics are touched rarely.
+// Where components are solved concurrently, network and flow add up the
+// time of every thread rather than wall-clock time.
+struct Metrics {
+    std::atomic<long long> cliques{0}; // Listing and counting cliques, (k,Ψ)-core peeling
+    std::atomic<long long> network{0}; // Splitting components and building flow networks
+    std::atomic<long long> flow{0};    // Max-flow solves
+
+    std::atomic<long long> cliquesListed{0};    // h-cliques counted plus (h-1)-cliques stored
+    std::atomic<long long> flowNetworks{0};
+    std::atomic<long long> flowNodes{0};
+    std::atomic<long long> flowArcs{0};         // Forward arcs, reverse arcs not counted
+    std::atomic<long long> flowSolves{0};
+    std::atomic<long long> bfsPhases{0};        // Dinic level graphs
+    std::atomic<long long> augmentingPaths{0};  // Dinic augmentations
+    std::atomic<long long> pushes{0};
+    std::atomic<long long> relabels{0};
+    std::atomic<long long> searchIterations{0}; // Dinkelbach steps or bisection iterations
+    std::atomic<long long> componentsSolved{0};
+    std::atomic<long long> componentsSkipped{0};
+};
+
+inline Metrics metrics;
+
+// --quiet: no progress output from inner loops (listing, flow, search steps)
+inline bool quietMode = false;
+inline std::ostream discardedOutput(nullptr);
+
+// Where progress messages go: std::cout, or nowhere under --quiet
+inline std::ostream& progressOutput() {
+    return quietMode ? discardedOutput : std::cout;
+}
+
+// Largest resident set of the process so far, in kilobytes
+inline long peakResidentKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// --perf: hardware counters per phase. Every thread that enters a phase
+// opens its own perf_event_open group on first use; a PhaseClock reads the
+// group when it starts and stops and adds the difference, scaled up when the
+// kernel multiplexed the group, to that phase's totals (perf_counters.h).
+struct PerfPhases {
+    PerfTotals cliques;
+    PerfTotals network;
+    PerfTotals flow;
+};
+
+inline bool perfEnabled = false;
+inline PerfPhases perfPhases;
+
+// This thread's group, opened on first use; null unless --perf is on
+inline const PerfGroup* threadPerfGroup() {
+    if (!perfEnabled) return nullptr;
+    thread_local std::unique_ptr<PerfGroup> group(new PerfGroup());
+    return group->ready() ? group.get() : nullptr;
+}
+
+// Turn on --perf if the main thread can open a group at all
+inline bool enablePerfCounters(std::string& reason) {
+    PerfGroup probe;
+    if (!probe.ready()) {
+        reason = strerror(probe.error);
+        return false;
+    }
+    perfEnabled = true;
+    return true;
+}
+
+inline void printPerfTotals() {
+    std::cout << "Counters (cliques): " << formatPerfTotals(perfPhases.cliques) << std::endl;
+    std::cout << "Counters (network): " << formatPerfTotals(perfPhases.network) << std::endl;
+    std::cout << "Counters (flow): " << formatPerfTotals(perfPhases.flow) << std::endl;
+}
+
+// Write the metrics of this run as one JSON object
+inline bool writeMetrics(const std::string& path, double loadMs, double totalMs) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "{\n  \"phasesMs\": {\"load\": " << loadMs << ", \"cliques\": " << metrics.cliques / 1000.0
+        << ", \"network\": " << metrics.network / 1000.0 << ", \"flow\": " << metrics.flow / 1000.0
+        << ", \"total\": " << totalMs << "},\n  \"counters\": {"
+        << "\"cliquesListed\": " << metrics.cliquesListed
+        << ", \"flowNetworks\": " << metrics.flowNetworks
+        << ", \"flowNodes\": " << metrics.flowNodes
+        << ", \"flowArcs\": " << metrics.flowArcs
+        << ", \"flowSolves\": " << metrics.flowSolves
+        << ", \"bfsPhases\": " << metrics.bfsPhases
+        << ", \"augmentingPaths\": " << metrics.augmentingPaths
+        << ", \"pushes\": " << metrics.pushes
+        << ", \"relabels\": " << metrics.relabels
+        << ", \"searchIterations\": " << metrics.searchIterations
+        << ", \"componentsSolved\": " << metrics.componentsSolved
+        << ", \"componentsSkipped\": " << metrics.componentsSkipped
+        << "},\n  \"peakRssKb\": " << peakResidentKb();
+    if (perfEnabled) {
+        out << ",\n  \"hardwareCounters\": {\"cliques\": " << perfTotalsJson(perfPhases.cliques)
+            << ", \"network\": " << perfTotalsJson(perfPhases.network)
+            << ", \"flow\": " << perfTotalsJson(perfPhases.flow) << "}";
+    }
+    out << "\n}\n";
+    return (bool)out;
+}
+
+// Counter totals of the phase this thread's innermost PhaseClock is timing
+inline thread_local PerfTotals* activePerfPhase = nullptr;
+
+// Adds its own lifetime to one phase total, and with --perf the hardware
+// counts of the same span to the phase's counter totals
+class PhaseClock {
+private:
+    std::atomic<long long>& total;
+    PerfTotals& counters;
+    PerfTotals* outer;
+    const PerfGroup* group;
+    PerfReading first;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    PhaseClock(std::atomic<long long>& phase, PerfTotals& phaseCounters)
+        : total(phase), counters(phaseCounters), outer(activePerfPhase), group(threadPerfGroup()) {
+        activePerfPhase = &counters;
+        if (group && !group->read(first)) group = nullptr;
+        start = std::chrono::steady_clock::now();
+    }
+
+    ~PhaseClock() {
+        total += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        PerfReading last;
+        if (group && group->read(last)) counters.add(*group, first, last);
+        activePerfPhase = outer;
+    }
+};
+
+// With --perf, adds the counts of one helper thread of a parallel step to
+// the counter totals of a phase. Worker 0 is the calling thread, which the
+// phase's PhaseClock already counts, so it is skipped.
+class WorkerCounters {
+private:
+    PerfTotals* counters;
+    const PerfGroup* group;
+    PerfReading first;
+
+public:
+    WorkerCounters(int worker, PerfTotals* phaseCounters)
+        : counters(phaseCounters), group(worker > 0 && phaseCounters ? threadPerfGroup() : nullptr) {
+        if (group && !group->read(first)) group = nullptr;
+    }
+
+    ~WorkerCounters() {
+        PerfReading last;
+        if (group && group->read(last)) counters->add(*group, first, last);
+    }
+};
+
+// Meters the workers of runTasks or StealingPool::run in the phase the
+// calling thread is in: pass the result as the pool's enter argument, or
+// call it with the task index at the top of a runTasks body
+inline auto meterWorkers() {
+    PerfTotals* phase = activePerfPhase;
+    return [phase](int worker) { return WorkerCounters(worker, phase); };
+}
+
+// Keeps a span out of --metrics and --perf: the cliques phase, the clique
+// counter and the cliques counter totals are put back when it ends. Wraps
+// the recount that checks a result, which is not part of the measured run.
+class UnmeteredSpan {
+private:
+    long long cliques;
+    long long cliquesListed;
+    long long perfValue[PERF_EVENTS];
+    bool perfSeen[PERF_EVENTS];
+
+public:
+    UnmeteredSpan() : cliques(metrics.cliques), cliquesListed(metrics.cliquesListed) {
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            perfValue[e] = perfPhases.cliques.value[e];
+            perfSeen[e] = perfPhases.cliques.seen[e];
+        }
+    }
+
+    ~UnmeteredSpan() {
+        metrics.cliques = cliques;
+        metrics.cliquesListed = cliquesListed;
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            perfPhases.cliques.value[e] = perfValue[e];
+            perfPhases.cliques.seen[e] = perfSeen[e];
+        }
+    }
+};
+
+#endif
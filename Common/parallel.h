@@ -0,0 +1,167 @@
+// Thread fan-out and the work-stealing task pool shared by
+// Algorithm1/algo1.cpp and Algorithm4/CoreExact.cpp
+#ifndef COMMON_PARALLEL_H
+#define COMMON_PARALLEL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Run task(0) .. task(count - 1), each on its own thread; a single task runs
+// on the calling thread
+template <class Task>
+void runTasks(int count, Task task) {
+    if (count <= 1) {
+        if (count == 1) task(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int i = 1; i < count; i++) {
+        workers.emplace_back(task, i);
+    }
+    task(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Work-stealing task pool. Every worker owns a deque: it pushes and pops
+// tasks at the back, and a worker whose deque is empty steals from the
+// front of another's, where the oldest (usually largest) tasks wait. A task
+// may push new tasks while it runs; run() returns when all have finished.
+template <class Task>
+class StealingPool {
+public:
+    // What one worker did during run()
+    struct WorkerStats {
+        long long tasks = 0;
+        long long steals = 0;
+        double idleMs = 0;
+    };
+
+    explicit StealingPool(int workers) : queues(workers), stats(workers) {}
+
+    int workerCount() const { return queues.size(); }
+
+    // Queue a task on a worker; callable before run() and from inside tasks
+    void push(int worker, const Task& task) {
+        pending++;
+        std::lock_guard<std::mutex> hold(queues[worker].lock);
+        queues[worker].tasks.push_back(task);
+    }
+
+    // Call process(task, worker) for every task, including those pushed
+    // while running, on workerCount() threads
+    template <class Process>
+    void run(Process process) {
+        run(process, [](int) { return 0; });
+    }
+
+    // The same, but every worker first calls enter(worker) on its own thread
+    // and keeps the result alive until it runs out of tasks, e.g. to meter
+    // the thread for the whole of its loop
+    template <class Process, class Enter>
+    void run(Process process, Enter enter) {
+        runTasks(workerCount(), [&](int worker) {
+            auto scope = enter(worker);
+            (void)scope;
+            work(worker, process);
+        });
+    }
+
+    const std::vector<WorkerStats>& workerStats() const { return stats; }
+
+    // One-line summary, e.g. "1200 tasks, 35 steals, 4 ms idle on 8 threads"
+    std::string summary() const {
+        long long tasks = 0, steals = 0;
+        double idle = 0;
+        for (const auto& one : stats) {
+            tasks += one.tasks;
+            steals += one.steals;
+            idle += one.idleMs;
+        }
+        char line[160];
+        std::snprintf(line, sizeof(line), "%lld tasks, %lld steals, %.1f ms idle on %d threads",
+                 tasks, steals, idle, workerCount());
+        return line;
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<Queue> queues;
+    std::vector<WorkerStats> stats;
+    std::atomic<long long> pending{0}; // queued or running tasks
+
+    bool popOwn(int worker, Task& task) {
+        std::lock_guard<std::mutex> hold(queues[worker].lock);
+        if (queues[worker].tasks.empty()) return false;
+        task = queues[worker].tasks.back();
+        queues[worker].tasks.pop_back();
+        return true;
+    }
+
+    // Try every other worker once, starting from a pseudo-random victim
+    bool steal(int thief, Task& task, unsigned& seed) {
+        int count = workerCount();
+        seed = seed * 1103515245u + 12345u;
+        int start = (seed >> 16) % count;
+        for (int i = 0; i < count; i++) {
+            int victim = (start + i) % count;
+            if (victim == thief) continue;
+            std::lock_guard<std::mutex> hold(queues[victim].lock);
+            if (queues[victim].tasks.empty()) continue;
+            task = queues[victim].tasks.front();
+            queues[victim].tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    template <class Process>
+    void work(int worker, Process& process) {
+        WorkerStats& mine = stats[worker];
+        unsigned seed = 2654435761u * (worker + 1);
+        bool idle = false;
+        auto idleSince = std::chrono::steady_clock::now();
+        Task task;
+        while (true) {
+            bool found = popOwn(worker, task);
+            if (!found && steal(worker, task, seed)) {
+                found = true;
+                mine.steals++;
+            }
+            if (found) {
+                if (idle) {
+                    mine.idleMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - idleSince).count();
+                    idle = false;
+                }
+                process(task, worker);
+                mine.tasks++;
+                pending--;
+                continue;
+            }
+
+            // Tasks may still appear while others run, so only stop at zero
+            if (pending.load() == 0) break;
+            if (!idle) {
+                idle = true;
+                idleSince = std::chrono::steady_clock::now();
+            }
+            std::this_thread::yield();
+        }
+        if (idle) {
+            mine.idleMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - idleSince).count();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,161 @@
+// Linux hardware counter groups behind --perf, shared by
+// Algorithm1/algo1.cpp and Algorithm4/CoreExact.cpp: the event table, one
+// perf_event_open group per thread, per-phase totals and their text and
+// JSON forms. Each program decides which threads open a group and which
+// spans are charged to which phase.
+#ifndef COMMON_PERF_COUNTERS_H
+#define COMMON_PERF_COUNTERS_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// Events counted by every group, in the order they are printed
+struct PerfEventKind {
+    const char* name;
+    uint32_t type;
+    uint64_t config;
+};
+
+const int PERF_EVENTS = 6;
+
+#if defined(__linux__)
+const PerfEventKind perfEventKinds[PERF_EVENTS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"L1d misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"dTLB misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+#else
+const PerfEventKind perfEventKinds[PERF_EVENTS] = {
+    {"cycles", 0, 0}, {"instructions", 0, 0}, {"L1d misses", 0, 0},
+    {"LLC misses", 0, 0}, {"branch misses", 0, 0}, {"dTLB misses", 0, 0},
+};
+#endif
+
+// One reading of a group: raw counts plus the time the group was enabled
+// and actually running on the PMU
+struct PerfReading {
+    uint64_t enabled = 0;
+    uint64_t running = 0;
+    uint64_t value[PERF_EVENTS] = {};
+};
+
+// Counter group of the calling thread. Events the CPU or kernel refuse are
+// left out; the first one that opens leads the group.
+class PerfGroup {
+private:
+    int fd[PERF_EVENTS];
+    int slot[PERF_EVENTS]; // Position of each event in a group read, -1 if not opened
+    int leader = -1;
+    int opened = 0;
+
+public:
+    int error = 0; // errno of the first event that failed to open
+
+    PerfGroup() {
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            fd[e] = slot[e] = -1;
+#if defined(__linux__)
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = perfEventKinds[e].type;
+            attr.config = perfEventKinds[e].config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fd[e] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fd[e] < 0) {
+                if (!error) error = errno;
+                continue;
+            }
+            if (leader < 0) leader = fd[e];
+            slot[e] = opened++;
+#else
+            error = ENOSYS;
+#endif
+        }
+    }
+
+    ~PerfGroup() {
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if (fd[e] >= 0) close(fd[e]);
+        }
+    }
+
+    bool ready() const { return leader >= 0; }
+    bool counts(int e) const { return slot[e] >= 0; }
+
+    bool read(PerfReading& reading) const {
+        if (leader < 0) return false;
+        uint64_t buffer[3 + PERF_EVENTS];
+        ssize_t bytes = ::read(leader, buffer, sizeof(buffer));
+        if (bytes < (ssize_t)((3 + opened) * sizeof(uint64_t))) return false;
+        reading.enabled = buffer[1];
+        reading.running = buffer[2];
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            reading.value[e] = slot[e] >= 0 ? buffer[3 + slot[e]] : 0;
+        }
+        return true;
+    }
+};
+
+// Counts summed over all threads for one phase
+struct PerfTotals {
+    std::atomic<long long> value[PERF_EVENTS] = {};
+    std::atomic<bool> seen[PERF_EVENTS] = {}; // Some thread counted this event
+
+    void add(const PerfGroup& group, const PerfReading& from, const PerfReading& to) {
+        uint64_t running = to.running - from.running;
+        if (running == 0) return;
+        double scale = (double)(to.enabled - from.enabled) / running;
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if (!group.counts(e)) continue;
+            value[e] += (long long)((to.value[e] - from.value[e]) * scale);
+            seen[e] = true;
+        }
+    }
+};
+
+// One line of counts for a phase; events no thread could count read n/a
+inline std::string formatPerfTotals(const PerfTotals& totals) {
+    std::ostringstream out;
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        out << (e ? ", " : "") << perfEventKinds[e].name << " ";
+        if (totals.seen[e]) out << totals.value[e];
+        else out << "n/a";
+    }
+    if (totals.seen[0] && totals.seen[1] && totals.value[0] > 0) {
+        out << ", IPC " << std::fixed << std::setprecision(2) << (double)totals.value[1] / totals.value[0];
+    }
+    return out.str();
+}
+
+// The same counts as a JSON object; events never counted are null
+inline std::string perfTotalsJson(const PerfTotals& totals) {
+    std::ostringstream out;
+    out << "{";
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        out << (e ? ", " : "") << "\"" << perfEventKinds[e].name << "\": ";
+        if (totals.seen[e]) out << totals.value[e];
+        else out << "null";
+    }
+    out << "}";
+    return out.str();
+}
+
+#endif
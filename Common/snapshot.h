@@ -0,0 +1,231 @@
+// Memory-mapped storage and the binary CSR snapshot format (<dataset>.csr)
+// shared by Algorithm1/algo1.cpp and Algorithm4/CoreExact.cpp. Either
+// program reads the snapshots the other writes, so the layout lives here only.
+#ifndef COMMON_SNAPSHOT_H
+#define COMMON_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only mapping of a whole file, unmapped on destruction
+class MappedFile {
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (base) munmap(const_cast<char*>(base), length);
+    }
+
+    // Map the file; false if it is missing, empty or cannot be mapped
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+            close(fd);
+            return false;
+        }
+        void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) return false;
+
+        madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+        base = static_cast<const char*>(mapping);
+        length = info.st_size;
+        return true;
+    }
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+};
+
+// Read-only int array that either owns its elements or borrows them from
+// a mapped file, which the shared handle then keeps alive. Copies of a
+// borrowing array share the mapping instead of duplicating it.
+class IntArray {
+private:
+    std::vector<int> owned;
+    std::shared_ptr<const MappedFile> backing;
+    const int* first = nullptr;
+    size_t length = 0;
+
+public:
+    IntArray() {}
+    IntArray(IntArray&&) = default;
+    IntArray& operator=(IntArray&&) = default;
+
+    IntArray(const IntArray& other) {
+        *this = other;
+    }
+
+    IntArray& operator=(const IntArray& other) {
+        if (this == &other) return *this;
+        owned = other.owned;
+        backing = other.backing;
+        length = other.length;
+        first = backing ? other.first : owned.data();
+        return *this;
+    }
+
+    void adopt(std::vector<int>&& values) {
+        owned = std::move(values);
+        backing.reset();
+        first = owned.data();
+        length = owned.size();
+    }
+
+    void borrow(std::shared_ptr<const MappedFile> file, const int* values, size_t count) {
+        std::vector<int>().swap(owned);
+        backing = std::move(file);
+        first = values;
+        length = count;
+    }
+
+    // Append values; a borrowed array is first copied into owned storage
+    void append(const int* values, size_t count) {
+        if (backing) {
+            owned.assign(first, first + length);
+            backing.reset();
+        }
+        owned.insert(owned.end(), values, values + count);
+        first = owned.data();
+        length = owned.size();
+    }
+
+    const int* data() const { return first; }
+    size_t size() const { return length; }
+    int operator[](size_t i) const { return first[i]; }
+    const int* begin() const { return first; }
+    const int* end() const { return first + length; }
+};
+
+// Snapshot layout: this header, then 32-bit CSR offsets (n + 1) and
+// neighbour rows, the degeneracy DAG in the same form, and the original id
+// of every vertex. Source size and mtime detect a snapshot gone stale.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;
+    int64_t sourceBytes;
+    int64_t sourceModified; // nanoseconds since the epoch
+    int64_t vertexCount;
+    int64_t adjacencyEntries;
+    int64_t dagEntries;
+    int64_t degeneracy;
+    int64_t maxDegree;
+};
+
+const char SNAPSHOT_MAGIC[8] = {'C', 'D', 'S', 'G', 'R', 'A', 'P', 'H'};
+const uint32_t SNAPSHOT_VERSION = 1;
+const int64_t SNAPSHOT_MAX_VERTICES = 1000000;
+
+// The arrays of one snapshot: what writeSnapshotFile stores, and what
+// mapSnapshotFile points into the mapping
+struct SnapshotView {
+    int64_t vertexCount = 0;
+    int64_t adjacencyEntries = 0;
+    int64_t dagEntries = 0;
+    int64_t degeneracy = 0;
+    int64_t maxDegree = 0;
+    const int* rowOffsets = nullptr;
+    const int* rowNeighbors = nullptr;
+    const int* dagOffsets = nullptr;
+    const int* dagNeighbors = nullptr;
+    const int* originalIds = nullptr;
+};
+
+inline int64_t modificationTime(const struct stat& info) {
+    return (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+// Write the snapshot to a temporary file and rename it into place, so a
+// concurrent run never maps a half-written snapshot
+inline bool writeSnapshotFile(const std::string& path, const struct stat& source, const SnapshotView& graph) {
+    int64_t n = graph.vertexCount;
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerBytes = sizeof(SnapshotHeader);
+    header.sourceBytes = source.st_size;
+    header.sourceModified = modificationTime(source);
+    header.vertexCount = n;
+    header.adjacencyEntries = graph.adjacencyEntries;
+    header.dagEntries = graph.dagEntries;
+    header.degeneracy = graph.degeneracy;
+    header.maxDegree = graph.maxDegree;
+
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    auto put = [&](const void* bytes, size_t count) {
+        out.write(static_cast<const char*>(bytes), count);
+    };
+    put(&header, sizeof(header));
+    put(graph.rowOffsets, sizeof(int) * (n + 1));
+    put(graph.rowNeighbors, sizeof(int) * graph.adjacencyEntries);
+    put(graph.dagOffsets, sizeof(int) * (n + 1));
+    put(graph.dagNeighbors, sizeof(int) * graph.dagEntries);
+    put(graph.originalIds, sizeof(int) * n);
+    out.close();
+
+    if (!out || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Map a snapshot and point view into it. Fails when the file is missing,
+// from another version, inconsistent, or does not match the source file.
+inline bool mapSnapshotFile(const std::string& path, const struct stat& source,
+                            std::shared_ptr<MappedFile>& file, SnapshotView& view) {
+    file = std::make_shared<MappedFile>();
+    if (!file->open(path) || file->size() < sizeof(SnapshotHeader)) return false;
+
+    SnapshotHeader header;
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.headerBytes != sizeof(SnapshotHeader)) {
+        return false;
+    }
+    if (header.sourceBytes != source.st_size || header.sourceModified != modificationTime(source)) {
+        return false;
+    }
+
+    int64_t n = header.vertexCount;
+    if (n <= 0 || n > SNAPSHOT_MAX_VERTICES || header.adjacencyEntries < 0 || header.dagEntries < 0) return false;
+    size_t ints = 3 * (size_t)n + 2 + header.adjacencyEntries + header.dagEntries;
+    if (file->size() != sizeof(SnapshotHeader) + sizeof(int) * ints) return false;
+
+    view.vertexCount = n;
+    view.adjacencyEntries = header.adjacencyEntries;
+    view.dagEntries = header.dagEntries;
+    view.degeneracy = header.degeneracy;
+    view.maxDegree = header.maxDegree;
+    view.rowOffsets = reinterpret_cast<const int*>(file->data() + sizeof(SnapshotHeader));
+    view.rowNeighbors = view.rowOffsets + n + 1;
+    view.dagOffsets = view.rowNeighbors + header.adjacencyEntries;
+    view.dagNeighbors = view.dagOffsets + n + 1;
+    view.originalIds = view.dagNeighbors + header.dagEntries;
+    return view.rowOffsets[n] == header.adjacencyEntries && view.dagOffsets[n] == header.dagEntries;
+}
+
+#endif